@@ -11,10 +11,18 @@ limitations under the License.
 ==============================================================================*/
 
 // This example shows how to read an ADC using DMA. For a simpler but slower
-// version, see examples/adc_interrupt.
+// version, see examples/adc_interrupt. The DMA interrupt handler only
+// acknowledges the hardware, and defers processing each block to a work
+// queue that runs from PendSV, so it never holds up other interrupts. The
+// volume of every block is passed to the main loop through a lock-free ring,
+// so it can report the loudest block since the last log message.
 
 #include "adc.h"
+#include "atomic.h"
 #include "debug_log.h"
+#include "interrupts.h"
+#include "signal_stats.h"
+#include "work_queue.h"
 
 #define DMA_BUFFER_SIZE (1024)
 uint16_t g_dma_buffer[DMA_BUFFER_SIZE];
@@ -24,11 +32,28 @@ int32_t g_half_count;
 int32_t g_complete_count;
 int32_t g_current_volume;
 
+#define VOLUME_RING_CAPACITY (16)
+uint32_t g_volume_values[VOLUME_RING_CAPACITY];
+SpscRing g_volume_ring;
+
+SignalStatsTracker g_stats_tracker;
+SignalStats g_stats;
+
+#define WORK_QUEUE_CAPACITY (8)
+WorkItem g_work_items[WORK_QUEUE_CAPACITY];
+WorkQueue g_work_queue;
+
 void main(void) {
   g_error_count = 0;
   g_half_count = 0;
   g_complete_count = 0;
   g_current_volume = 0;
+  SpscRingInit(&g_volume_ring, g_volume_values, VOLUME_RING_CAPACITY);
+  SignalStatsInit(&g_stats_tracker, (DMA_BUFFER_SIZE / 2), 3);
+  WorkQueueInit(&g_work_queue, g_work_items, WORK_QUEUE_CAPACITY, 1);
+  // The DMA handler must never wait behind anything, so it gets the most
+  // urgent priority. The work queue's PendSV is already the least urgent.
+  InterruptSetPriority(DMA1_Channel1_IRQn, INTERRUPT_PRIORITY_HIGHEST, 0);
 
   // Start up the clock system.
   RccInitForAdc();
@@ -39,47 +64,56 @@ void main(void) {
   AdcDmaOn(g_dma_buffer, DMA_BUFFER_SIZE);
   // AdcOn();
   while (1) {
+    uint32_t peak_volume = 0;
+    uint32_t volume;
+    while (SpscRingPop(&g_volume_ring, &volume)) {
+      if (volume > peak_volume) {
+        peak_volume = volume;
+      }
+    }
     const int32_t adc_log_length = 256;
     char adc_log[adc_log_length];
     StrCpy(adc_log, adc_log_length, "DMA: ");
     StrCatInt32(adc_log, adc_log_length, g_current_volume);
     StrCatStr(adc_log, adc_log_length, " volume, ");
+    StrCatInt32(adc_log, adc_log_length, peak_volume);
+    StrCatStr(adc_log, adc_log_length, " peak, ");
+    StrCatInt32(adc_log, adc_log_length, g_stats_tracker.average.rms);
+    StrCatStr(adc_log, adc_log_length, " average rms, ");
     StrCatInt32(adc_log, adc_log_length, g_error_count);
     StrCatStr(adc_log, adc_log_length, " errors, ");
     StrCatInt32(adc_log, adc_log_length, g_half_count);
     StrCatStr(adc_log, adc_log_length, " half, ");
     StrCatInt32(adc_log, adc_log_length, g_complete_count);
-    StrCatStr(adc_log, adc_log_length, " complete\n");
+    StrCatStr(adc_log, adc_log_length, " complete, ");
+    StrCatInt32(adc_log, adc_log_length,
+                WorkQueueAverageLatency(&g_work_queue));
+    StrCatStr(adc_log, adc_log_length, " average cycles latency, ");
+    StrCatInt32(adc_log, adc_log_length, g_work_queue.max_latency_cycles);
+    StrCatStr(adc_log, adc_log_length, " max, ");
+    StrCatInt32(adc_log, adc_log_length, g_work_queue.high_water);
+    StrCatStr(adc_log, adc_log_length, " queue high water\n");
     DebugLog(adc_log);
   }
   AdcOff();
 }
 
-void ProcessDmaBuffer(const uint16_t* buffer, int start_index, int end_index) {
-  const uint16_t* start = (buffer + start_index);
-  const uint16_t* current;
-  const uint16_t* const end = (buffer + end_index);
-  int32_t total = 0;
-  for (current = start; current != end; ++current) {
-    total += *current;
-  }
-  const int count = (end_index - start_index);
-  const int32_t mean = (total / count);
-  uint32_t total_volume = 0;
-  for (current = start; current != end; ++current) {
-    const uint16_t current_value = *current;
-    const int32_t delta = (current_value - mean);
-    int32_t abs_delta;
-    if (delta < 0) {
-      abs_delta = -delta;
-    } else {
-      abs_delta = delta;
-    }
-    total_volume += abs_delta;
-  }
-  g_current_volume = (total_volume / count);
+// Works out the volume of the latest block of samples, using the mean absolute
+// deviation, along with the other summary statistics.
+void ProcessDmaBuffer(const uint16_t* buffer, int start_index) {
+  SignalStatsProcessAdc(&g_stats_tracker, buffer + start_index, &g_stats);
+  g_current_volume = g_stats.mean_abs_deviation;
+  SpscRingPush(&g_volume_ring, g_current_volume);
 }
 
+// Runs from the work queue, with the offset of the block as the argument.
+void ProcessDmaBufferWork(void* arg) {
+  ProcessDmaBuffer(g_dma_buffer, (int)(arg));
+}
+
+// The work queue runs here, once no other interrupt handlers are active.
+void OnPendSV() { WorkQueueRunPending(&g_work_queue); }
+
 void OnDma1Channel1Interrupt() {
   if (DMA1->ISR & DMA_ISR_TEIF1) {
     ++g_error_count;
@@ -89,13 +123,14 @@ void OnDma1Channel1Interrupt() {
   if (DMA1->ISR & DMA_ISR_HTIF1) {
     ++g_half_count;
     DMA1->IFCR |= DMA_IFCR_CHTIF1;
-    ProcessDmaBuffer(g_dma_buffer, 0, (DMA_BUFFER_SIZE / 2));
+    WorkQueuePost(&g_work_queue, ProcessDmaBufferWork, (void*)(0));
     return;
   }
   if (DMA1->ISR & DMA_ISR_TCIF1) {
     ++g_complete_count;
     DMA1->IFCR |= DMA_IFCR_CTCIF1;
-    ProcessDmaBuffer(g_dma_buffer, (DMA_BUFFER_SIZE / 2), DMA_BUFFER_SIZE);
+    WorkQueuePost(&g_work_queue, ProcessDmaBufferWork,
+                  (void*)(DMA_BUFFER_SIZE / 2));
     return;
   }
 }
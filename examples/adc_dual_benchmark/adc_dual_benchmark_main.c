@@ -0,0 +1,103 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Measures the sample rates the two dual ADC modes actually achieve, by
+// timestamping DMA half and full transfer interrupts with SysTick. Regular
+// simultaneous mode reads pins A0 and A1 together, and fast interleaved mode
+// reads A0 at twice the rate a single ADC can manage.
+
+#include "adc.h"
+#include "debug_log.h"
+
+// SysTick counts processor cycles directly, so setting it to interrupt after
+// a fixed number of them lets us convert ticks into cycles.
+#define CYCLES_PER_TICK (10000)
+
+#define DMA_WORD_COUNT (1024)
+#define HALF_WORD_COUNT (DMA_WORD_COUNT / 2)
+uint32_t g_dma_buffer[DMA_WORD_COUNT];
+
+// How many half-buffers to time, after skipping the first one so that the
+// start-up latency isn't included.
+#define BLOCKS_TO_TIME (64)
+
+volatile int32_t g_block_count;
+volatile uint32_t g_first_ticks;
+volatile uint32_t g_last_ticks;
+int32_t g_error_count;
+
+static void BenchmarkMode(int dual_mode, int sample_time,
+                          int samples_per_word) {
+  g_block_count = 0;
+  AdcDualInit(dual_mode, 0, 1, sample_time);
+  AdcDualStart(g_dma_buffer, DMA_WORD_COUNT);
+  while (g_block_count <= BLOCKS_TO_TIME) {
+  }
+  AdcDualStop();
+  DMA1->CCR1 &= ~DMA_CCR_EN;
+
+  const uint32_t duration_ticks = g_last_ticks - g_first_ticks;
+  const uint64_t cycles = (uint64_t)(duration_ticks)*CYCLES_PER_TICK;
+  const uint64_t samples =
+      (uint64_t)(BLOCKS_TO_TIME)*HALF_WORD_COUNT * samples_per_word;
+  const uint32_t sample_rate =
+      (uint32_t)((samples * ClockGetHclkRate()) / cycles);
+
+  if (dual_mode == ADC_DUAL_REGULAR_SIMULTANEOUS) {
+    DebugLog("Regular simultaneous: ");
+  } else {
+    DebugLog("Fast interleaved: ");
+  }
+  DebugLogUInt32(sample_rate);
+  DebugLog(" samples per second, ");
+  DebugLogUInt32(sample_rate / samples_per_word);
+  DebugLog(" DMA words per second\n");
+}
+
+void main(void) {
+  g_error_count = 0;
+
+  // Start up the clock system.
+  RccInitForAdc();
+
+  g_tick_count = 0;
+  SysTick_Config(CYCLES_PER_TICK);
+  DmaInit();
+  DebugLog("Benchmarking dual ADC modes\n");
+
+  // Both ADCs convert a pair every 68 ADC clocks, so at 1.125MHz we expect
+  // 16.5K pairs, or 33K samples, per second.
+  BenchmarkMode(ADC_DUAL_REGULAR_SIMULTANEOUS, ADC_SAMPLE_TIME_55_5_CYCLES, 2);
+  // A conversion every 7 ADC clocks should give around 160K samples per
+  // second, from a single pin.
+  BenchmarkMode(ADC_DUAL_FAST_INTERLEAVED, ADC_SAMPLE_TIME_1_5_CYCLES, 2);
+
+  DebugLogInt32(g_error_count);
+  DebugLog(" DMA errors\n");
+}
+
+void OnDma1Channel1Interrupt() {
+  if (DMA1->ISR & DMA_ISR_TEIF1) {
+    ++g_error_count;
+    DMA1->IFCR |= DMA_IFCR_CTEIF1;
+    return;
+  }
+  if (DMA1->ISR & (DMA_ISR_HTIF1 | DMA_ISR_TCIF1)) {
+    DMA1->IFCR |= DMA_IFCR_CHTIF1 | DMA_IFCR_CTCIF1;
+    if (g_block_count == 0) {
+      g_first_ticks = g_tick_count;
+    } else if (g_block_count == BLOCKS_TO_TIME) {
+      g_last_ticks = g_tick_count;
+    }
+    ++g_block_count;
+  }
+}
@@ -11,42 +11,72 @@ limitations under the License.
 ==============================================================================*/
 
 // This example shows how to read an ADC using interrupts. This is slower than
-// continuously DMA-ing the data into a buffer, but simpler.
+// continuously DMA-ing the data into a buffer, but simpler. The interrupt
+// handler only reads the value, and leaves the slow job of logging it to a
+// work queue that the main loop runs.
 
 #include "adc.h"
 #include "debug_log.h"
+#include "power.h"
+#include "work_queue.h"
+
+#define WORK_QUEUE_CAPACITY (4)
+WorkItem g_work_items[WORK_QUEUE_CAPACITY];
+WorkQueue g_work_queue;
 
 // You need a function named "main" in your program to act like "main" in
 // traditional C. This will be called when the processor starts up.
 void main(void) {
+  WorkQueueInit(&g_work_queue, g_work_items, WORK_QUEUE_CAPACITY, 0);
+
   // Start up the clock system.
   RccInitForAdc();
+  PowerInit();
 
   // TODO: At the moment, only port A0 seems to be working.
   AdcInit(GPIOA, 0, 1);
   while (1) {
     // Calls to AdcOn() cause the interrupt to be called back once
-    // a value is available.
+    // a value is available. Sleep until then rather than spinning, with
+    // interrupts masked so that a conversion that finishes before we get to
+    // sleep still wakes us.
+    __disable_irq();
     AdcOn();
+    PowerSleep();
+    __enable_irq();
+    WorkQueueRunPending(&g_work_queue);
   }
   AdcOff();
 }
 
+// Outputs a value to the debug log. This is much too slow to do inside the
+// interrupt handler, so it runs from the work queue instead.
+void LogAdcValue(void* arg) {
+  const int32_t adc_value = (int32_t)(arg);
+  const int32_t adc_log_length = 256;
+  char adc_log[adc_log_length];
+  StrCpy(adc_log, adc_log_length, "ADC: ");
+  StrCatInt32(adc_log, adc_log_length, adc_value);
+  StrCatStr(adc_log, adc_log_length, "\n");
+  DebugLog(adc_log);
+}
+
+// Reports an interrupt that didn't come with a new value, also from the work
+// queue, since logging from the handler would hold up the next conversion.
+void LogUnexpectedInterrupt(void* arg) {
+  DebugLog("ADC Interrupt called outside of an End Of Conversion event.\n");
+}
+
 // If you have a function named OnAdcInterrupt() in your program, this will be
 // called once an ADC value is available, if you've set up the system as shown
 // in the main() function above.
 void OnAdcInterrupt() {
   // We're expecting an EOC signal to be marked in the status register.
   if (!(ADC1->SR & ADC_SR_EOC)) {
-    DebugLog("ADC Interrupt called outside of an End Of Conversion event.\n");
+    WorkQueuePost(&g_work_queue, LogUnexpectedInterrupt, 0);
     return;
   }
-  // Read the value from the data register and output it to the debug log.
+  // Reading the data register also clears the EOC flag.
   const int32_t adc_value = ADC1->DR;
-  const int32_t adc_log_length = 256;
-  char adc_log[adc_log_length];
-  StrCpy(adc_log, adc_log_length, "ADC: ");
-  StrCatInt32(adc_log, adc_log_length, adc_value);
-  StrCatStr(adc_log, adc_log_length, "\n");
-  DebugLog(adc_log);
+  WorkQueuePost(&g_work_queue, LogAdcValue, (void*)(adc_value));
 }
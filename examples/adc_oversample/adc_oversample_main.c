@@ -0,0 +1,100 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// This example reads a slowly changing sensor on pin A0 with 14 bits of
+// resolution, by oversampling the 12-bit ADC. TIM3 triggers raw samples at
+// 16 times the output rate, DMA collects them, and each half-buffer
+// interrupt turns them into 14-bit results.
+
+#include "adc.h"
+#include "adc_oversample.h"
+#include "debug_log.h"
+
+#define EXTRA_BITS (2)
+#define OUTPUT_RATE (100)
+
+// Each half-buffer holds enough raw samples for eight results.
+#define DMA_BUFFER_SIZE (256)
+#define BLOCK_SIZE (DMA_BUFFER_SIZE / 2)
+uint16_t g_dma_buffer[DMA_BUFFER_SIZE];
+
+#define MAX_OUTPUTS_PER_BLOCK (BLOCK_SIZE)
+uint16_t g_outputs[MAX_OUTPUTS_PER_BLOCK];
+
+static const AdcChannelConfig g_channel = {0, ADC_SAMPLE_TIME_239_5_CYCLES};
+
+AdcOversampler g_oversampler;
+int32_t g_error_count;
+int32_t g_output_count;
+int32_t g_latest_value;
+
+void main(void) {
+  g_error_count = 0;
+  g_output_count = 0;
+  g_latest_value = 0;
+  AdcOversamplerInit(&g_oversampler, EXTRA_BITS);
+
+  // Start up the clock system.
+  RccInitForAdc();
+
+  AdcTriggeredInit(&g_channel, 1, ADC_TRIGGER_TIM3_TRGO);
+  DmaInit();
+  AdcDmaOn(g_dma_buffer, DMA_BUFFER_SIZE);
+  const int32_t input_rate = AdcTimerTriggerStart(
+      ADC_TRIGGER_TIM3_TRGO, AdcOversampleInputRate(OUTPUT_RATE, EXTRA_BITS),
+      TimerGetClockRate(TIMERID_TIM3));
+  while (1) {
+    const int32_t adc_log_length = 256;
+    char adc_log[adc_log_length];
+    StrCpy(adc_log, adc_log_length, "Oversampled: ");
+    StrCatInt32(adc_log, adc_log_length, g_latest_value);
+    StrCatStr(adc_log, adc_log_length, " (");
+    StrCatInt32(adc_log, adc_log_length, 12 + EXTRA_BITS);
+    StrCatStr(adc_log, adc_log_length, " bits), ");
+    StrCatInt32(adc_log, adc_log_length, input_rate);
+    StrCatStr(adc_log, adc_log_length, "Hz input, ");
+    StrCatInt32(adc_log, adc_log_length, g_output_count);
+    StrCatStr(adc_log, adc_log_length, " results, ");
+    StrCatInt32(adc_log, adc_log_length, g_error_count);
+    StrCatStr(adc_log, adc_log_length, " errors\n");
+    DebugLog(adc_log);
+  }
+  AdcTimerTriggerStop(ADC_TRIGGER_TIM3_TRGO);
+  AdcOff();
+}
+
+void ProcessDmaBuffer(const uint16_t* block) {
+  const int count =
+      AdcOversamplerProcess(&g_oversampler, block, BLOCK_SIZE, g_outputs);
+  if (count > 0) {
+    g_latest_value = g_outputs[count - 1];
+    g_output_count += count;
+  }
+}
+
+void OnDma1Channel1Interrupt() {
+  if (DMA1->ISR & DMA_ISR_TEIF1) {
+    ++g_error_count;
+    DMA1->IFCR |= DMA_IFCR_CTEIF1;
+    return;
+  }
+  if (DMA1->ISR & DMA_ISR_HTIF1) {
+    DMA1->IFCR |= DMA_IFCR_CHTIF1;
+    ProcessDmaBuffer(g_dma_buffer);
+    return;
+  }
+  if (DMA1->ISR & DMA_ISR_TCIF1) {
+    DMA1->IFCR |= DMA_IFCR_CTCIF1;
+    ProcessDmaBuffer(g_dma_buffer + BLOCK_SIZE);
+    return;
+  }
+}
@@ -0,0 +1,108 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// This example shows how to read several ADC channels at once, using scan
+// mode and DMA, so that the CPU is only involved once every half-buffer. It
+// reads pins A0 and A1, along with the chip's internal temperature sensor and
+// voltage reference, and logs the average of each.
+
+#include "adc.h"
+#include "debug_log.h"
+
+#define CHANNEL_COUNT (4)
+static const AdcChannelConfig g_channels[CHANNEL_COUNT] = {
+    {0, ADC_SAMPLE_TIME_55_5_CYCLES},
+    {1, ADC_SAMPLE_TIME_55_5_CYCLES},
+    // The internal channels need at least 17.1us of sampling, which is the
+    // longest time available at the ADC clock rate we're using.
+    {ADC_CHANNEL_TEMPERATURE, ADC_SAMPLE_TIME_239_5_CYCLES},
+    {ADC_CHANNEL_VREFINT, ADC_SAMPLE_TIME_239_5_CYCLES},
+};
+static char* g_channel_names[CHANNEL_COUNT] = {
+    "A0",
+    "A1",
+    "temperature",
+    "vrefint",
+};
+
+#define FRAME_COUNT (64)
+#define HALF_FRAME_COUNT (FRAME_COUNT / 2)
+uint16_t g_dma_buffer[FRAME_COUNT * CHANNEL_COUNT];
+
+int32_t g_error_count;
+int32_t g_block_count;
+int32_t g_channel_means[CHANNEL_COUNT];
+
+void main(void) {
+  g_error_count = 0;
+  g_block_count = 0;
+  for (int i = 0; i < CHANNEL_COUNT; ++i) {
+    g_channel_means[i] = 0;
+  }
+
+  // Start up the clock system.
+  RccInitForAdc();
+
+  AdcScanInit(g_channels, CHANNEL_COUNT);
+  DmaInit();
+  AdcScanStart(g_dma_buffer, FRAME_COUNT, CHANNEL_COUNT);
+  while (1) {
+    const int32_t adc_log_length = 256;
+    char adc_log[adc_log_length];
+    StrCpy(adc_log, adc_log_length, "Scan: ");
+    for (int i = 0; i < CHANNEL_COUNT; ++i) {
+      StrCatStr(adc_log, adc_log_length, g_channel_names[i]);
+      StrCatStr(adc_log, adc_log_length, "=");
+      StrCatInt32(adc_log, adc_log_length, g_channel_means[i]);
+      StrCatStr(adc_log, adc_log_length, ", ");
+    }
+    StrCatInt32(adc_log, adc_log_length, g_block_count);
+    StrCatStr(adc_log, adc_log_length, " blocks, ");
+    StrCatInt32(adc_log, adc_log_length, g_error_count);
+    StrCatStr(adc_log, adc_log_length, " errors\n");
+    DebugLog(adc_log);
+  }
+  AdcOff();
+}
+
+// Averages each channel in a block of frames, reading the values in place
+// through a view rather than copying them out.
+void ProcessDmaBuffer(const uint16_t* block) {
+  for (int i = 0; i < CHANNEL_COUNT; ++i) {
+    const AdcChannelView view =
+        AdcScanChannelView(block, HALF_FRAME_COUNT, CHANNEL_COUNT, i);
+    int32_t total = 0;
+    for (int j = 0; j < view.count; ++j) {
+      total += AdcChannelViewGet(&view, j);
+    }
+    g_channel_means[i] = total / view.count;
+  }
+  ++g_block_count;
+}
+
+void OnDma1Channel1Interrupt() {
+  if (DMA1->ISR & DMA_ISR_TEIF1) {
+    ++g_error_count;
+    DMA1->IFCR |= DMA_IFCR_CTEIF1;
+    return;
+  }
+  if (DMA1->ISR & DMA_ISR_HTIF1) {
+    DMA1->IFCR |= DMA_IFCR_CHTIF1;
+    ProcessDmaBuffer(g_dma_buffer);
+    return;
+  }
+  if (DMA1->ISR & DMA_ISR_TCIF1) {
+    DMA1->IFCR |= DMA_IFCR_CTCIF1;
+    ProcessDmaBuffer(g_dma_buffer + (HALF_FRAME_COUNT * CHANNEL_COUNT));
+    return;
+  }
+}
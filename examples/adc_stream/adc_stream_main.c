@@ -0,0 +1,105 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// This example shows how to read ADC samples from a circular DMA buffer as
+// soon as they arrive, without any interrupts, by polling the DMA position.
+// It lights the LED whenever a short chunk of samples from pin A0 gets loud,
+// which reacts within a millisecond or so, even though the buffer is as big
+// as in the other DMA examples.
+
+#include "adc.h"
+#include "debug_log.h"
+#include "dma.h"
+#include "led.h"
+
+// How far from the midpoint a sample has to be to count as loud.
+#define LOUD_THRESHOLD (300)
+
+// How many samples to look at in one go, which sets the latency. At 16.5KHz,
+// this is just under a millisecond.
+#define CHUNK_SIZE (16)
+
+// Log after this many chunks, which is around ten seconds.
+#define CHUNKS_PER_LOG (10000)
+
+#define DMA_BUFFER_SIZE (1024)
+uint16_t g_dma_buffer[DMA_BUFFER_SIZE];
+
+DmaRingReader g_reader;
+
+void main(void) {
+  // Start up the clock system.
+  RccInitForAdc();
+  LedInit();
+
+  AdcInit(GPIOA, 0, 0);
+  DmaInit();
+  AdcDmaOnPolled(g_dma_buffer, DMA_BUFFER_SIZE);
+  DmaRingReaderInit(&g_reader, 1, g_dma_buffer, DMA_BUFFER_SIZE);
+
+  int32_t chunk_count = 0;
+  int32_t loud_chunk_count = 0;
+  while (1) {
+    if (DmaRingReaderAvailable(&g_reader) < CHUNK_SIZE) {
+      continue;
+    }
+    // Look at the samples in place, which can take two peeks if the chunk
+    // wraps around the end of the buffer.
+    int32_t peak = 0;
+    int remaining = CHUNK_SIZE;
+    while (remaining > 0) {
+      const uint16_t* data;
+      int count = DmaRingReaderPeek(&g_reader, &data);
+      if (count > remaining) {
+        count = remaining;
+      }
+      for (int i = 0; i < count; ++i) {
+        int32_t delta = data[i] - 2048;
+        if (delta < 0) {
+          delta = -delta;
+        }
+        if (delta > peak) {
+          peak = delta;
+        }
+      }
+      DmaRingReaderConsume(&g_reader, count);
+      remaining -= count;
+    }
+
+    if (peak > LOUD_THRESHOLD) {
+      LedOn();
+      ++loud_chunk_count;
+    } else {
+      LedOff();
+    }
+
+    ++chunk_count;
+    if (chunk_count >= CHUNKS_PER_LOG) {
+      // Logging is slow, and takes much longer than the buffer lasts, so
+      // throw away what arrived in the meantime afterwards.
+      const int32_t adc_log_length = 256;
+      char adc_log[adc_log_length];
+      StrCpy(adc_log, adc_log_length, "Stream: ");
+      StrCatInt32(adc_log, adc_log_length, loud_chunk_count);
+      StrCatStr(adc_log, adc_log_length, " loud chunks out of ");
+      StrCatInt32(adc_log, adc_log_length, chunk_count);
+      StrCatStr(adc_log, adc_log_length, ", ");
+      StrCatInt32(adc_log, adc_log_length, g_reader.overrun_count);
+      StrCatStr(adc_log, adc_log_length, " overruns\n");
+      DebugLog(adc_log);
+      DmaRingReaderSkip(&g_reader);
+      chunk_count = 0;
+      loud_chunk_count = 0;
+    }
+  }
+  AdcOff();
+}
@@ -0,0 +1,111 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// This example shows how to sample an ADC at an exact rate, here 8KHz, by
+// having TIM3 trigger each conversion. DMA moves the results into a circular
+// buffer, so the CPU isn't involved until a half-buffer is ready. The log
+// shows the requested and achieved rates, along with the rate measured by
+// counting blocks against SysTick.
+
+#include "adc.h"
+#include "debug_log.h"
+#include "signal_stats.h"
+
+#define SAMPLE_RATE (8000)
+
+#define DMA_BUFFER_SIZE (512)
+#define BLOCK_SIZE (DMA_BUFFER_SIZE / 2)
+uint16_t g_dma_buffer[DMA_BUFFER_SIZE];
+
+static const AdcChannelConfig g_channel = {0, ADC_SAMPLE_TIME_55_5_CYCLES};
+
+int32_t g_error_count;
+volatile int32_t g_block_count;
+volatile uint32_t g_first_block_ticks;
+volatile uint32_t g_last_block_ticks;
+
+SignalStatsTracker g_stats_tracker;
+SignalStats g_stats;
+
+void main(void) {
+  g_error_count = 0;
+  g_block_count = 0;
+  SignalStatsInit(&g_stats_tracker, BLOCK_SIZE, 3);
+
+  // Start up the clock system.
+  RccInitForAdc();
+  g_tick_count = 0;
+  // SysTick counts processor cycles, so this gives us a tick per millisecond.
+  SysTick_Config(ClockGetHclkRate() / 1000);
+
+  AdcTriggeredInit(&g_channel, 1, ADC_TRIGGER_TIM3_TRGO);
+  DmaInit();
+  AdcDmaOn(g_dma_buffer, DMA_BUFFER_SIZE);
+  const int32_t achieved_rate =
+      AdcTimerTriggerStart(ADC_TRIGGER_TIM3_TRGO, SAMPLE_RATE,
+                           TimerGetClockRate(TIMERID_TIM3));
+  while (1) {
+    // Work out the rate we're really seeing from the block timestamps.
+    int32_t measured_rate = 0;
+    const int32_t block_count = g_block_count;
+    const uint32_t elapsed_ms = g_last_block_ticks - g_first_block_ticks;
+    if ((block_count > 1) && (elapsed_ms > 0)) {
+      measured_rate =
+          (int32_t)(((uint64_t)(block_count - 1) * BLOCK_SIZE * 1000) /
+                    elapsed_ms);
+    }
+
+    const int32_t adc_log_length = 256;
+    char adc_log[adc_log_length];
+    StrCpy(adc_log, adc_log_length, "Timer ADC: ");
+    StrCatInt32(adc_log, adc_log_length, SAMPLE_RATE);
+    StrCatStr(adc_log, adc_log_length, "Hz requested, ");
+    StrCatInt32(adc_log, adc_log_length, achieved_rate);
+    StrCatStr(adc_log, adc_log_length, "Hz programmed, ");
+    StrCatInt32(adc_log, adc_log_length, measured_rate);
+    StrCatStr(adc_log, adc_log_length, "Hz measured, ");
+    StrCatInt32(adc_log, adc_log_length, g_stats_tracker.average.rms);
+    StrCatStr(adc_log, adc_log_length, " average rms, ");
+    StrCatInt32(adc_log, adc_log_length, g_error_count);
+    StrCatStr(adc_log, adc_log_length, " errors\n");
+    DebugLog(adc_log);
+  }
+  AdcTimerTriggerStop(ADC_TRIGGER_TIM3_TRGO);
+  AdcOff();
+}
+
+void ProcessDmaBuffer(const uint16_t* block) {
+  if (g_block_count == 0) {
+    g_first_block_ticks = g_tick_count;
+  }
+  g_last_block_ticks = g_tick_count;
+  ++g_block_count;
+  SignalStatsProcessAdc(&g_stats_tracker, block, &g_stats);
+}
+
+void OnDma1Channel1Interrupt() {
+  if (DMA1->ISR & DMA_ISR_TEIF1) {
+    ++g_error_count;
+    DMA1->IFCR |= DMA_IFCR_CTEIF1;
+    return;
+  }
+  if (DMA1->ISR & DMA_ISR_HTIF1) {
+    DMA1->IFCR |= DMA_IFCR_CHTIF1;
+    ProcessDmaBuffer(g_dma_buffer);
+    return;
+  }
+  if (DMA1->ISR & DMA_ISR_TCIF1) {
+    DMA1->IFCR |= DMA_IFCR_CTCIF1;
+    ProcessDmaBuffer(g_dma_buffer + BLOCK_SIZE);
+    return;
+  }
+}
@@ -21,7 +21,7 @@ limitations under the License.
 void main(void) {
   // Set up SysTick to call back every millisecond.
   g_tick_count = 0;
-  SysTick_Config(CLOCK_RATE / 10000);
+  SysTick_Config(ClockGetHclkRate() / 1000);
   DebugLog("Benchmarking started\n");
 
   volatile int32_t a = 42;
@@ -0,0 +1,93 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Times the biquad cascade filters, and reports how many processor cycles
+// each sample takes to pass through a single section.
+
+#include "adc.h"
+#include "biquad.h"
+#include "debug_log.h"
+
+// SysTick counts processor cycles directly, so setting it to interrupt after
+// a fixed number of them lets us convert ticks into cycles, whatever the
+// clock rate is.
+#define CYCLES_PER_TICK (10000)
+
+// Same size as the half-buffers in the ADC DMA examples.
+#define SAMPLE_COUNT (512)
+#define MAX_SECTIONS (4)
+
+// A 100Hz high-pass followed by a 4KHz low-pass, both second-order
+// Butterworth designs for a 16.5KHz sample rate, repeated to fill out four
+// sections. The coefficients are scaled by 0.5, for a post_shift of 1.
+static const int16_t g_coefficients[MAX_SECTIONS * BIQUAD_COEFFICIENT_COUNT] = {
+    15950, -31900, 15950, 31888, -15527,  // High-pass.
+    4554,  9107,   4554,  992,   -2822,   // Low-pass.
+    15950, -31900, 15950, 31888, -15527,  // High-pass.
+    4554,  9107,   4554,  992,   -2822,   // Low-pass.
+};
+
+int16_t g_samples[SAMPLE_COUNT];
+int32_t g_state[4 * MAX_SECTIONS];
+
+static void BenchmarkCascade(enum BiquadForm form, int section_count) {
+  BiquadCascade cascade;
+  BiquadCascadeInit(&cascade, form, g_coefficients, section_count, 1, 1,
+                    g_state);
+  for (int i = 0; i < SAMPLE_COUNT; ++i) {
+    g_samples[i] = ((i * 97) % 4096) - 2048;
+  }
+
+  const int repetitions = 100;
+  const uint32_t start_ticks = g_tick_count;
+  for (int i = 0; i < repetitions; ++i) {
+    BiquadCascadeProcess(&cascade, g_samples, SAMPLE_COUNT);
+  }
+  const uint32_t duration_ticks = g_tick_count - start_ticks;
+  const uint32_t cycles = duration_ticks * CYCLES_PER_TICK;
+  const uint32_t sample_sections = repetitions * SAMPLE_COUNT * section_count;
+  // Report hundredths of a cycle, since the numbers are small.
+  const uint32_t centicycles_per_sample_section =
+      (cycles / sample_sections) * 100 +
+      ((cycles % sample_sections) * 100) / sample_sections;
+
+  if (form == BIQUAD_DIRECT_FORM_1) {
+    DebugLog("Direct form I, ");
+  } else {
+    DebugLog("Transposed direct form II, ");
+  }
+  DebugLogInt32(section_count);
+  DebugLog(" sections: ");
+  DebugLogUInt32(centicycles_per_sample_section / 100);
+  DebugLog(".");
+  const uint32_t fraction = centicycles_per_sample_section % 100;
+  if (fraction < 10) {
+    DebugLog("0");
+  }
+  DebugLogUInt32(fraction);
+  DebugLog(" cycles per sample per section\n");
+}
+
+void main(void) {
+  // Run at the same clock and flash settings as the ADC examples, since the
+  // flash wait states affect the cycle counts.
+  RccInitForAdc();
+
+  g_tick_count = 0;
+  SysTick_Config(CYCLES_PER_TICK);
+  DebugLog("Benchmarking biquad filters\n");
+
+  for (int sections = 1; sections <= MAX_SECTIONS; ++sections) {
+    BenchmarkCascade(BIQUAD_DIRECT_FORM_1, sections);
+    BenchmarkCascade(BIQUAD_TRANSPOSED_FORM_2, sections);
+  }
+}
@@ -13,8 +13,8 @@ limitations under the License.
 // This example shows how to write a minimal "Blue Pill" program that blinks the
 // LED continuously.
 
+#include "delay.h"
 #include "led.h"
-#include "timers.h"
 
 // You need a function named "main" in your program to act like "main" in
 // traditional C. This will be called when the processor starts up.
@@ -24,11 +24,10 @@ void main(void) {
   // We'll keep looping forever, turning the LED on and off.
   while (1) {
     LedOn();
-    // This delay function is inefficient because it has the processor spin in
-    // a loop executing no-ops, rather than going to sleep and saving power.
-    // It's simpler to call though, so we'll use it for this example.
-    BusyWaitMicroseconds(200 * 1000);
+    // This delay function sleeps between timer interrupts, rather than having
+    // the processor spin in a loop, so it saves power while we wait.
+    DelaySleepMilliseconds(200);
     LedOff();
-    BusyWaitMicroseconds(200 * 1000);
+    DelaySleepMilliseconds(200);
   }
 }
@@ -14,6 +14,7 @@ limitations under the License.
 
 #include "adc.h"
 #include "debug_log.h"
+#include "timebase.h"
 
 #define ADC_LOG_LENGTH (256)
 
@@ -617,7 +618,7 @@ static inline void BenchmarkSmallReferenceConv() {
   const int output_mult = 1;
   uint8_t output_data[expected_elements];
   const int repetitions = 1000;
-  volatile uint16_t start_time = TimerGetCounter(TIMERID_TIM1);
+  volatile uint32_t start_time = TimebaseGet32();
   for (int i = 0; i < repetitions; ++i) {
     ReferenceConv(image_data, image_batch_count, image_height, image_width,
                   image_depth, image_offset, filter_data, filter_size,
@@ -625,8 +626,8 @@ static inline void BenchmarkSmallReferenceConv() {
                   output_data, expected_height, expected_width, output_shift,
                   output_offset, output_mult);
   }
-  volatile uint16_t duration = TimerGetCounter(TIMERID_TIM1) - start_time;
-  const int32_t microseconds_per_conv = (duration * 1000) / repetitions;
+  volatile uint32_t duration = TimebaseGet32() - start_time;
+  const int32_t microseconds_per_conv = duration / repetitions;
   const int32_t op_count =
       expected_elements * image_depth * filter_size * filter_size * 2;
   const int32_t ops_per_second = (op_count * 1000000) / microseconds_per_conv;
@@ -713,7 +714,7 @@ static inline void BenchmarkSmallSymmetricalConv() {
   const int output_mult = 1;
   uint8_t output_data[expected_elements];
   const int repetitions = 1000;
-  volatile uint16_t start_time = TimerGetCounter(TIMERID_TIM1);
+  volatile uint32_t start_time = TimebaseGet32();
   for (int i = 0; i < repetitions; ++i) {
     FastSymmetricalConv(image_data, image_batch_count, image_height, image_width,
 			image_depth, filter_data, filter_height,
@@ -721,8 +722,8 @@ static inline void BenchmarkSmallSymmetricalConv() {
 			output_data, expected_height, expected_width, output_shift,
 			output_offset, output_mult);
   }
-  volatile uint16_t duration = TimerGetCounter(TIMERID_TIM1) - start_time;
-  const int32_t microseconds_per_conv = (duration * 1000) / repetitions;
+  volatile uint32_t duration = TimebaseGet32() - start_time;
+  const int32_t microseconds_per_conv = duration / repetitions;
   const int32_t op_count =
       expected_elements * image_depth * filter_height * filter_width * 2;
   const int32_t ops_per_second = (op_count * 1000000) / microseconds_per_conv;
@@ -782,7 +783,7 @@ static void BenchmarkReferenceConv(int image_batch_count, int image_height,
   const int output_mult = 1;
   uint8_t output_data[expected_elements];
   const int repetitions = 10;
-  volatile uint16_t start_time = TimerGetCounter(TIMERID_TIM1);
+  volatile uint32_t start_time = TimebaseGet32();
   for (int i = 0; i < repetitions; ++i) {
     ReferenceConv(image_data, image_batch_count, image_height, image_width,
                   image_depth, image_offset, filter_data, filter_height,
@@ -790,8 +791,8 @@ static void BenchmarkReferenceConv(int image_batch_count, int image_height,
                   output_data, expected_height, expected_width, output_shift,
                   output_offset, output_mult);
   }
-  volatile uint16_t duration = TimerGetCounter(TIMERID_TIM1) - start_time;
-  const int32_t microseconds_per_conv = (duration * 1000) / repetitions;
+  volatile uint32_t duration = TimebaseGet32() - start_time;
+  const int32_t microseconds_per_conv = duration / repetitions;
   const int32_t op_count =
       expected_elements * image_depth * filter_height * filter_width * 2;
   const int32_t ops_per_second =
@@ -852,7 +853,7 @@ static void BenchmarkSymmetricalConv(int image_batch_count, int image_height,
   const int output_mult = 1;
   uint8_t output_data[expected_elements];
   const int repetitions = 10;
-  volatile uint16_t start_time = TimerGetCounter(TIMERID_TIM1);
+  volatile uint32_t start_time = TimebaseGet32();
   if (image_depth == 1 && 0) {
     for (int i = 0; i < repetitions; ++i) {
       FastSymmetricalOneChannelConv(image_data, image_batch_count, image_height,
@@ -870,8 +871,8 @@ static void BenchmarkSymmetricalConv(int image_batch_count, int image_height,
 			  output_offset, output_mult);
     }
   }
-  volatile uint16_t duration = TimerGetCounter(TIMERID_TIM1) - start_time;
-  const int32_t microseconds_per_conv = (duration * 1000) / repetitions;
+  volatile uint32_t duration = TimebaseGet32() - start_time;
+  const int32_t microseconds_per_conv = duration / repetitions;
   const int32_t op_count =
       expected_elements * image_depth * filter_height * filter_width * 2;
   const int32_t ops_per_second =
@@ -928,7 +929,7 @@ void main(void) {
   // Start up the clock system.
   RccInitForAdc();
 
-  TimerInit(TIMERID_TIM1);
+  TimebaseInit();
 
   int32_t total = 0;
   int8_t input_value = 10;
@@ -0,0 +1,193 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Compares the cost of resuming a stackless coroutine with calling the next
+// step of a callback-driven state machine, and then runs a small DMA
+// pipeline written as two coroutines. One copies blocks into a pair of
+// buffers with DMA, and the other sums each block while the next one is
+// being copied.
+
+#include "clocks.h"
+#include "coroutine.h"
+#include "debug_log.h"
+#include "delay.h"
+#include "dma.h"
+#include "timebase.h"
+
+#define SWITCH_COUNT (10000)
+
+#define BLOCK_WORDS (256)
+#define BLOCK_COUNT (32)
+
+static volatile uint32_t g_step_count = 0;
+
+// The coroutine version counts one step per resume.
+static Coroutine g_counting_co;
+
+__attribute__((noinline)) static int CountingCoroutine(Coroutine* co) {
+  COROUTINE_BEGIN(co);
+  while (1) {
+    ++g_step_count;
+    COROUTINE_YIELD(co);
+    ++g_step_count;
+    COROUTINE_YIELD(co);
+  }
+  COROUTINE_END(co);
+}
+
+// The callback version does the same, with each step setting up the next.
+typedef void (*StepFunction)(void);
+static volatile StepFunction g_next_step;
+
+static void StepB(void);
+
+__attribute__((noinline)) static void StepA(void) {
+  ++g_step_count;
+  g_next_step = StepB;
+}
+
+__attribute__((noinline)) static void StepB(void) {
+  ++g_step_count;
+  g_next_step = StepA;
+}
+
+static void LogCycles(char* label, uint32_t cycles, uint32_t count) {
+  DebugLog(label);
+  DebugLog(": ");
+  DebugLogUInt32(cycles / count);
+  DebugLog(".");
+  const uint32_t hundredths = ((cycles % count) * 100) / count;
+  if (hundredths < 10) {
+    DebugLog("0");
+  }
+  DebugLogUInt32(hundredths);
+  DebugLog(" cycles per switch\n");
+}
+
+static void BenchmarkSwitches(void) {
+  CoroutineInit(&g_counting_co);
+  g_step_count = 0;
+  uint32_t start = DWT->CYCCNT;
+  for (int i = 0; i < SWITCH_COUNT; ++i) {
+    CountingCoroutine(&g_counting_co);
+  }
+  LogCycles("Coroutine", DWT->CYCCNT - start, SWITCH_COUNT);
+
+  g_next_step = StepA;
+  g_step_count = 0;
+  start = DWT->CYCCNT;
+  for (int i = 0; i < SWITCH_COUNT; ++i) {
+    g_next_step();
+  }
+  LogCycles("Callback", DWT->CYCCNT - start, SWITCH_COUNT);
+}
+
+// The pipeline's data, and the flags the two halves use to hand buffers
+// back and forth.
+static uint32_t g_source[BLOCK_WORDS * 4];
+static uint32_t g_buffers[2][BLOCK_WORDS];
+static volatile int g_is_full[2];
+
+typedef struct {
+  Coroutine co;
+  int channel;
+  int block;
+} Copier;
+
+typedef struct {
+  Coroutine co;
+  int block;
+  uint32_t total;
+} Summer;
+
+static int CopierCoroutine(Copier* copier) {
+  COROUTINE_BEGIN(&copier->co);
+  for (copier->block = 0; copier->block < BLOCK_COUNT; ++copier->block) {
+    COROUTINE_WAIT_UNTIL(&copier->co, !g_is_full[copier->block % 2]);
+    // The source is smaller than the whole stream, so it's reused.
+    DmaCopyStart(copier->channel, g_buffers[copier->block % 2],
+                 &g_source[(copier->block % 4) * BLOCK_WORDS], BLOCK_WORDS,
+                 DMA_WIDTH_32, CoroutineDmaWake, 0);
+    COROUTINE_WAIT_DMA(&copier->co, copier->channel);
+    g_is_full[copier->block % 2] = 1;
+  }
+  COROUTINE_END(&copier->co);
+}
+
+static int SummerCoroutine(Summer* summer) {
+  COROUTINE_BEGIN(&summer->co);
+  for (summer->block = 0; summer->block < BLOCK_COUNT; ++summer->block) {
+    COROUTINE_WAIT_UNTIL(&summer->co, g_is_full[summer->block % 2]);
+    const uint32_t* buffer = g_buffers[summer->block % 2];
+    for (int i = 0; i < BLOCK_WORDS; ++i) {
+      summer->total += buffer[i];
+    }
+    g_is_full[summer->block % 2] = 0;
+  }
+  COROUTINE_END(&summer->co);
+}
+
+static void RunPipeline(void) {
+  const int channel = DmaClaimChannel();
+  if (channel == 0) {
+    DebugLog("No DMA channel available\n");
+    return;
+  }
+  uint32_t expected = 0;
+  for (int i = 0; i < (BLOCK_WORDS * 4); ++i) {
+    g_source[i] = i * 7;
+  }
+  for (int block = 0; block < BLOCK_COUNT; ++block) {
+    for (int i = 0; i < BLOCK_WORDS; ++i) {
+      expected += g_source[((block % 4) * BLOCK_WORDS) + i];
+    }
+  }
+
+  Copier copier;
+  CoroutineInit(&copier.co);
+  copier.channel = channel;
+  Summer summer;
+  CoroutineInit(&summer.co);
+  summer.total = 0;
+  g_is_full[0] = 0;
+  g_is_full[1] = 0;
+
+  const uint32_t start = DWT->CYCCNT;
+  int is_copier_done = 0;
+  int is_summer_done = 0;
+  while (!is_copier_done || !is_summer_done) {
+    if (!is_copier_done) {
+      is_copier_done = CopierCoroutine(&copier);
+    }
+    if (!is_summer_done) {
+      is_summer_done = SummerCoroutine(&summer);
+    }
+  }
+  const uint32_t cycles = DWT->CYCCNT - start;
+  DmaReleaseChannel(channel);
+
+  DebugLog("Pipeline of ");
+  DebugLogInt32(BLOCK_COUNT);
+  DebugLog(" blocks took ");
+  DebugLogUInt32(cycles);
+  DebugLog(" cycles, ");
+  DebugLog((summer.total == expected) ? "sum matched\n" : "sum was wrong\n");
+}
+
+void main(void) {
+  ClockInitProfile(CLOCK_PROFILE_72MHZ);
+  DelayEnableCycleCounter();
+  TimebaseInit();
+
+  BenchmarkSwitches();
+  RunPipeline();
+}
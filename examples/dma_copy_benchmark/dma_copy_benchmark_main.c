@@ -0,0 +1,131 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Compares copying a buffer with the CPU against copying it with
+// memory-to-memory DMA, and shows how much of the DMA copy can be hidden by
+// doing some arithmetic at the same time. Timings are in processor cycles,
+// from the DWT cycle counter.
+
+#include "debug_log.h"
+#include "dma.h"
+
+#define WORD_COUNT (2048)
+uint32_t g_source[WORD_COUNT];
+uint32_t g_dest[WORD_COUNT];
+
+// How many multiply-accumulates to run alongside the copy.
+#define MAC_COUNT (4096)
+
+volatile int g_callback_count;
+
+static inline uint32_t GetCycles() { return DWT->CYCCNT; }
+
+static void OnCopyComplete(int channel, int has_error, void* arg) {
+  ++g_callback_count;
+}
+
+// Stays in registers, so it shouldn't compete with the DMA for the bus.
+static int32_t MultiplyAccumulate(int32_t seed) {
+  int32_t a = seed;
+  int32_t b = seed + 1;
+  int32_t total = 0;
+  for (int i = 0; i < MAC_COUNT; ++i) {
+    total += a * b;
+    a += 3;
+    b ^= total;
+  }
+  return total;
+}
+
+static void CpuCopy(uint32_t* dest, const uint32_t* source, int count) {
+  for (int i = 0; i < count; ++i) {
+    dest[i] = source[i];
+  }
+}
+
+static int CheckCopy() {
+  int error_count = 0;
+  for (int i = 0; i < WORD_COUNT; ++i) {
+    if (g_dest[i] != g_source[i]) {
+      ++error_count;
+    }
+  }
+  return error_count;
+}
+
+static void LogCycles(char* label, uint32_t cycles) {
+  DebugLog(label);
+  DebugLogUInt32(cycles);
+  DebugLog(" cycles\n");
+}
+
+void main(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  const int channel = DmaClaimChannel();
+  if (channel == 0) {
+    DebugLog("No DMA channel available\n");
+    return;
+  }
+  for (int i = 0; i < WORD_COUNT; ++i) {
+    g_source[i] = (i * 7919) ^ 0xa5a5a5a5;
+  }
+  DebugLog("Copying ");
+  DebugLogInt32(WORD_COUNT);
+  DebugLog(" words\n");
+
+  uint32_t start = GetCycles();
+  CpuCopy(g_dest, g_source, WORD_COUNT);
+  LogCycles("CPU copy: ", GetCycles() - start);
+
+  DmaFillStart(channel, g_dest, 0, WORD_COUNT, DMA_WIDTH_32, 0, 0);
+  DmaWait(channel);
+  start = GetCycles();
+  DmaCopyStart(channel, g_dest, g_source, WORD_COUNT, DMA_WIDTH_32, 0, 0);
+  int error_count = DmaWait(channel);
+  LogCycles("DMA copy: ", GetCycles() - start);
+  error_count += CheckCopy();
+
+  start = GetCycles();
+  int32_t total = MultiplyAccumulate(GetCycles());
+  LogCycles("Arithmetic alone: ", GetCycles() - start);
+
+  DmaFillStart(channel, g_dest, 0, WORD_COUNT, DMA_WIDTH_32, 0, 0);
+  DmaWait(channel);
+  g_callback_count = 0;
+  start = GetCycles();
+  DmaCopyStart(channel, g_dest, g_source, WORD_COUNT, DMA_WIDTH_32,
+               OnCopyComplete, 0);
+  total += MultiplyAccumulate(GetCycles());
+  error_count += DmaWait(channel);
+  LogCycles("DMA copy with arithmetic: ", GetCycles() - start);
+  error_count += CheckCopy();
+
+  DmaFillStart(channel, g_dest, 0xffffffff, WORD_COUNT, DMA_WIDTH_32, 0, 0);
+  error_count += DmaWait(channel);
+  for (int i = 0; i < WORD_COUNT; ++i) {
+    if (g_dest[i] != 0xffffffff) {
+      ++error_count;
+    }
+  }
+  DmaReleaseChannel(channel);
+
+  // Log the arithmetic's result so it can't be optimized away.
+  DebugLog("Checksum ");
+  DebugLogHex(total);
+  DebugLog(", ");
+  DebugLogInt32(g_callback_count);
+  DebugLog(" callbacks, ");
+  DebugLogInt32(error_count);
+  DebugLog(" errors\n");
+}
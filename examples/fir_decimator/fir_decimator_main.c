@@ -0,0 +1,148 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the FIR decimator on synthetic tones, and times it.
+//
+// Blocks of raw 12-bit ADC values holding a pure tone are generated at a
+// 16KHz sample rate, the same size as the DMA half-buffers in the ADC
+// examples, and decimated by four down to 4KHz. For each tone the gain of
+// the filter is logged as a percentage, from the RMS of the output compared
+// to the input's. Tones below the 2KHz output Nyquist frequency should come
+// through close to 100%, and tones above it, which would otherwise alias
+// down into the output, should be almost completely removed.
+
+#include "adc.h"
+#include "debug_log.h"
+#include "delay.h"
+#include "fir_decimator.h"
+
+#define SAMPLE_RATE (16000)
+#define FACTOR (4)
+#define BLOCK_SIZE (512)
+// The first block is skipped, while the history fills up.
+#define BLOCK_COUNT (9)
+#define TONE_AMPLITUDE (1000)
+
+// A 1.6KHz low-pass, designed with a Hamming-windowed sinc, in Q15. The
+// response is about 99% at 250Hz, 95% at 1KHz, and below 0.05% from 3KHz up.
+#define TAP_COUNT (29)
+static const int16_t g_taps[TAP_COUNT] = {
+    39,   91,   139,  129,  0,    -271, -609, -832, -696, 0,
+    1297, 3011, 4755, 6059, 6542, 6059, 4755, 3011, 1297, 0,
+    -696, -832, -609, -271, 0,    129,  139,  91,   39,
+};
+
+// A quarter of a sine wave, in Q15, so the table's steps are SAMPLE_RATE / 64
+// or 250Hz apart.
+#define SINE_STEPS (64)
+static const int16_t g_quarter_sine[(SINE_STEPS / 4) + 1] = {
+    0,     3212,  6393,  9512,  12539, 15446, 18204, 20787, 23170,
+    25329, 27245, 28898, 30273, 31356, 32137, 32609, 32767,
+};
+
+int16_t g_history[TAP_COUNT - 1];
+uint16_t g_input[BLOCK_SIZE];
+int16_t g_output[BLOCK_SIZE / FACTOR];
+
+static int32_t Sine(int index) {
+  const int quarter = SINE_STEPS / 4;
+  index = index % SINE_STEPS;
+  if (index < quarter) {
+    return g_quarter_sine[index];
+  } else if (index < (2 * quarter)) {
+    return g_quarter_sine[(2 * quarter) - index];
+  } else if (index < (3 * quarter)) {
+    return -g_quarter_sine[index - (2 * quarter)];
+  } else {
+    return -g_quarter_sine[SINE_STEPS - index];
+  }
+}
+
+static uint32_t SquareRoot(uint64_t value) {
+  uint64_t result = 0;
+  uint64_t bit = (uint64_t)(1) << 62;
+  while (bit > value) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (value >= (result + bit)) {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return result;
+}
+
+static void MeasureTone(int frequency) {
+  const int step = frequency / (SAMPLE_RATE / SINE_STEPS);
+  FirDecimator decimator;
+  FirDecimatorInit(&decimator, g_taps, TAP_COUNT, FACTOR, g_history);
+
+  uint64_t total_squared = 0;
+  int output_total = 0;
+  uint32_t process_cycles = 0;
+  int sine_index = 0;
+  for (int block = 0; block < BLOCK_COUNT; ++block) {
+    for (int i = 0; i < BLOCK_SIZE; ++i) {
+      g_input[i] = FIR_DECIMATOR_ADC_OFFSET +
+                   ((Sine(sine_index) * TONE_AMPLITUDE) >> 15);
+      sine_index = (sine_index + step) % SINE_STEPS;
+    }
+    const uint32_t start = DWT->CYCCNT;
+    const int output_count =
+        FirDecimatorProcessAdc(&decimator, g_input, BLOCK_SIZE, g_output);
+    const uint32_t cycles = DWT->CYCCNT - start;
+    if (block == 0) {
+      continue;
+    }
+    process_cycles += cycles;
+    for (int i = 0; i < output_count; ++i) {
+      total_squared += g_output[i] * g_output[i];
+    }
+    output_total += output_count;
+  }
+
+  // A tone's RMS is its amplitude over root two, and converting to Q15
+  // multiplies the ADC values by 16, so the output's amplitude is compared
+  // to 16 times the input's.
+  const uint32_t output_amplitude =
+      SquareRoot((total_squared * 2) / output_total);
+  const uint32_t gain_percent =
+      (output_amplitude * 100) / (TONE_AMPLITUDE * 16);
+
+  DebugLogInt32(frequency);
+  DebugLog("Hz: ");
+  DebugLogUInt32(gain_percent);
+  DebugLog("% gain, ");
+  DebugLogUInt32(process_cycles / output_total);
+  DebugLog(" cycles per output\n");
+}
+
+void main(void) {
+  // Run at the same clock and flash settings as the ADC examples, since the
+  // flash wait states affect the cycle counts.
+  RccInitForAdc();
+  DelayEnableCycleCounter();
+  DebugLog("Decimating 16KHz tones by 4 with a ");
+  DebugLogInt32(TAP_COUNT);
+  DebugLog(" tap filter\n");
+
+  // Pass band, transition band, and two tones that would alias to 1KHz.
+  const int frequencies[] = {250, 1000, 2000, 3000, 7000};
+  const int frequency_count = sizeof(frequencies) / sizeof(frequencies[0]);
+  for (int i = 0; i < frequency_count; ++i) {
+    MeasureTone(frequencies[i]);
+  }
+}
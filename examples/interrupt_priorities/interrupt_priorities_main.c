@@ -0,0 +1,124 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Shows how interrupt priorities protect a latency-critical handler from a
+// slow one. TIM3 stands in for sample capture at 10kHz, and its handler
+// records how many cycles late it started, by reading the timer's counter.
+// TIM1's update interrupt stands in for long processing, with a handler that
+// runs for most of a millisecond, 100 times a second. TIM2 and TIM4 are left
+// alone, since the timebase uses them.
+//
+// - With both at the same priority, capture has to wait for processing to
+//   finish, so its worst-case latency is as long as the processing.
+// - With capture more urgent, it preempts the processing, and its latency
+//   stays at the exception entry time.
+// - A BASEPRI critical section in the main loop holds off processing, but
+//   capture still gets through.
+
+#include "clocks.h"
+#include "debug_log.h"
+#include "delay.h"
+#include "interrupts.h"
+#include "timers.h"
+
+#define CAPTURE_RATE (10000)
+#define PROCESSING_RATE (100)
+#define PROCESSING_CYCLES (50000)
+#define PHASE_MILLISECONDS (500)
+
+#define CAPTURE_PRIORITY (0)
+#define TIMEKEEPING_PRIORITY (1)
+#define PROCESSING_PRIORITY (3)
+
+static volatile uint32_t g_capture_count;
+static volatile uint32_t g_max_latency;
+static volatile uint32_t g_processing_count;
+
+void OnTim3Interrupt() {
+  // The counter started from zero at the update, and counts timer clocks.
+  const uint32_t latency = TIM3->CNT;
+  TIM3->SR = ~TIM_SR_UIF;
+  if (latency > g_max_latency) {
+    g_max_latency = latency;
+  }
+  ++g_capture_count;
+}
+
+void OnTim1UpdateInterrupt() {
+  TIM1->SR = ~TIM_SR_UIF;
+  DelayCycles(PROCESSING_CYCLES);
+  ++g_processing_count;
+}
+
+static void StartTimer(int timer_id, IRQn_Type irq, int32_t rate) {
+  TimerInitForRate(timer_id, rate, TimerGetClockRate(timer_id));
+  TIM_t* tim = TimerIdToStruct(timer_id);
+  tim->SR = 0;
+  tim->DIER = TIM_DIER_UIE;
+  InterruptEnable(irq);
+  tim->CR1 |= TIM_CR1_CEN;
+}
+
+static void ResetCounts(void) {
+  __disable_irq();
+  g_capture_count = 0;
+  g_max_latency = 0;
+  g_processing_count = 0;
+  __enable_irq();
+}
+
+static void LogCounts(char* label) {
+  DebugLog(label);
+  DebugLog(": ");
+  DebugLogUInt32(g_capture_count);
+  DebugLog(" captures, worst latency ");
+  DebugLogUInt32(g_max_latency);
+  DebugLog(" cycles, ");
+  DebugLogUInt32(g_processing_count);
+  DebugLog(" processing runs\n");
+}
+
+void main(void) {
+  ClockInitProfile(CLOCK_PROFILE_72MHZ);
+  DelayEnableCycleCounter();
+  // Two bits of preempt priority, for four levels, and two of sub priority.
+  InterruptSetGrouping(2);
+
+  InterruptSetPriority(TIM3_IRQn, CAPTURE_PRIORITY, 0);
+  InterruptSetPriority(TIM1_UP_IRQn, CAPTURE_PRIORITY, 1);
+  StartTimer(TIMERID_TIM3, TIM3_IRQn, CAPTURE_RATE);
+  StartTimer(TIMERID_TIM1, TIM1_UP_IRQn, PROCESSING_RATE);
+
+  while (1) {
+    // The sub priority means capture wins when both are pending at once, but
+    // it can't interrupt processing that's already started.
+    InterruptSetPriority(TIM1_UP_IRQn, CAPTURE_PRIORITY, 1);
+    ResetCounts();
+    DelayMilliseconds(PHASE_MILLISECONDS);
+    LogCounts("Same priority");
+
+    InterruptSetPriority(TIM1_UP_IRQn, PROCESSING_PRIORITY, 0);
+    ResetCounts();
+    DelayMilliseconds(PHASE_MILLISECONDS);
+    LogCounts("Capture more urgent");
+
+    // Mask everything from timekeeping down, which includes processing but
+    // not capture.
+    ResetCounts();
+    const uint32_t mask = InterruptMaskFrom(TIMEKEEPING_PRIORITY);
+    DelayMilliseconds(PHASE_MILLISECONDS);
+    LogCounts("Processing masked");
+    DebugLog(InterruptIsPending(TIM1_UP_IRQn) ? "Processing was held pending\n"
+                                           : "Processing wasn't pending\n");
+    InterruptRestoreMask(mask);
+  }
+}
@@ -10,26 +10,57 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
-// This example shows how to read an ADC using DMA. For a simpler but slower
-// version, see examples/adc_interrupt.
+// This example listens to a microphone on the ADC using DMA, and lights the
+// LED while it hears a whistle at around 1KHz. The tone is picked out with a
+// bank of Goertzel filters, which is much cheaper than running an FFT on
+// every block. For a simpler version that just reads the ADC, see
+// examples/adc_dma.
 
 #include "led.h"
 #include "adc.h"
 #include "debug_log.h"
+#include "goertzel.h"
+#include "power.h"
 
 #define DMA_BUFFER_SIZE (1024)
 uint16_t g_dma_buffer[DMA_BUFFER_SIZE];
 
+// The ADC setup in RccInitForAdc() samples at roughly 16.5KHz.
+#define SAMPLE_RATE (16544)
+
+// We listen for the whistle, and for its neighbours on either side, so that
+// broadband noise (which has energy at all three) can be told apart from a
+// clean tone.
+#define TONE_COUNT (3)
+#define WHISTLE_TONE_INDEX (1)
+const int32_t g_tone_frequencies[TONE_COUNT] = {700, 1000, 1400};
+
+// A tone counts as present if it holds at least a third of the block's energy.
+#define TONE_THRESHOLD (GOERTZEL_LEVEL_ONE / 3)
+
+GoertzelBank g_tone_bank;
+
 int32_t g_error_count;
 int32_t g_half_count;
 int32_t g_complete_count;
-int32_t g_current_volume;
+int32_t g_detection_count;
+uint32_t g_detected_tones;
+
+void OnToneDetected(int tone_index, int32_t level) {
+  if (tone_index == WHISTLE_TONE_INDEX) {
+    ++g_detection_count;
+  }
+}
 
 void main(void) {
   g_error_count = 0;
   g_half_count = 0;
   g_complete_count = 0;
-  g_current_volume = 0;
+  g_detection_count = 0;
+  g_detected_tones = 0;
+
+  GoertzelBankInit(&g_tone_bank, g_tone_frequencies, TONE_COUNT, SAMPLE_RATE,
+                   TONE_THRESHOLD, OnToneDetected);
 
   // Start up the clock system.
   RccInitForAdc();
@@ -40,41 +71,20 @@ void main(void) {
   AdcDmaOn(g_dma_buffer, DMA_BUFFER_SIZE);
   LedInit();
   // AdcOn();
+  PowerInit();
   while (1) {
-    if (g_current_volume > 10) {
+    if (g_detected_tones == (1 << WHISTLE_TONE_INDEX)) {
       LedOn();
     } else {
       LedOff();
     }
+    // All the work happens in the DMA interrupt, so there's nothing to do
+    // until the next one.
+    PowerSleep();
   }
   AdcOff();
 }
 
-void ProcessDmaBuffer(const uint16_t* buffer, int start_index, int end_index) {
-  const uint16_t* start = (buffer + start_index);
-  const uint16_t* current;
-  const uint16_t* const end = (buffer + end_index);
-  int32_t total = 0;
-  for (current = start; current != end; ++current) {
-    total += *current;
-  }
-  const int count = (end_index - start_index);
-  const int32_t mean = (total / count);
-  uint32_t total_volume = 0;
-  for (current = start; current != end; ++current) {
-    const uint16_t current_value = *current;
-    const int32_t delta = (current_value - mean);
-    int32_t abs_delta;
-    if (delta < 0) {
-      abs_delta = -delta;
-    } else {
-      abs_delta = delta;
-    }
-    total_volume += abs_delta;
-  }
-  g_current_volume = (total_volume / count);
-}
-
 void OnDma1Channel1Interrupt() {
   if (DMA1->ISR & DMA_ISR_TEIF1) {
     ++g_error_count;
@@ -84,13 +94,16 @@ void OnDma1Channel1Interrupt() {
   if (DMA1->ISR & DMA_ISR_HTIF1) {
     ++g_half_count;
     DMA1->IFCR |= DMA_IFCR_CHTIF1;
-    ProcessDmaBuffer(g_dma_buffer, 0, (DMA_BUFFER_SIZE / 2));
+    g_detected_tones = GoertzelBankProcessAdc(&g_tone_bank, g_dma_buffer,
+                                              (DMA_BUFFER_SIZE / 2));
     return;
   }
   if (DMA1->ISR & DMA_ISR_TCIF1) {
     ++g_complete_count;
     DMA1->IFCR |= DMA_IFCR_CTCIF1;
-    ProcessDmaBuffer(g_dma_buffer, (DMA_BUFFER_SIZE / 2), DMA_BUFFER_SIZE);
+    g_detected_tones = GoertzelBankProcessAdc(
+        &g_tone_bank, g_dma_buffer + (DMA_BUFFER_SIZE / 2),
+        (DMA_BUFFER_SIZE / 2));
     return;
   }
 }
@@ -0,0 +1,89 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Blinks the LED while spending as little time awake as possible. Each cycle
+// does a burst of work with the LED on, then waits in Sleep for SysTick with
+// the LED off, and then waits in Stop for the RTC alarm. Every few cycles it
+// logs how the time was split between the three states, and checks the PLL
+// came back after Stop.
+
+#include "clocks.h"
+#include "debug_log.h"
+#include "led.h"
+#include "power.h"
+#include "timers.h"
+
+#define TICKS_PER_SECOND (100)
+#define SLEEP_TICKS (20)
+#define STOP_MILLISECONDS (300)
+#define CYCLES_PER_LOG (4)
+
+// How long to spend pretending to do useful work on each cycle.
+#define WORK_CYCLES (100000)
+
+static void DoWork(void) {
+  const uint32_t start = DWT->CYCCNT;
+  while ((DWT->CYCCNT - start) < WORK_CYCLES) {
+  }
+}
+
+static void LogPercent(char* label, uint64_t cycles, uint64_t total) {
+  DebugLog(label);
+  DebugLogUInt32((uint32_t)((cycles * 100) / total));
+  DebugLog("% ");
+}
+
+void main(void) {
+  ClockInitProfile(CLOCK_PROFILE_72MHZ);
+  LedInit();
+  PowerInit();
+  PowerRtcInit(1);
+  g_tick_count = 0;
+  SysTick_Config(ClockGetHclkRate() / TICKS_PER_SECOND);
+
+  int cycle_count = 0;
+  while (1) {
+    LedOn();
+    DoWork();
+    LedOff();
+
+    // Sleep, with SysTick waking us every tick, until enough have passed.
+    // Interrupts are masked while we check the count, so the tick handler
+    // can't run between the check and the sleep, and it runs once they're
+    // unmasked again.
+    const uint32_t end_tick = g_tick_count + SLEEP_TICKS;
+    __disable_irq();
+    while ((int32_t)(end_tick - g_tick_count) > 0) {
+      PowerSleep();
+      __enable_irq();
+      __disable_irq();
+    }
+    __enable_irq();
+
+    PowerStopForMilliseconds(STOP_MILLISECONDS);
+
+    ++cycle_count;
+    if ((cycle_count % CYCLES_PER_LOG) == 0) {
+      PowerResidency residency;
+      PowerGetResidency(&residency);
+      PowerResetResidency();
+      const uint64_t total = residency.awake_cycles + residency.sleep_cycles +
+                             residency.stop_cycles;
+      LogPercent("Awake", residency.awake_cycles, total);
+      LogPercent("Sleep", residency.sleep_cycles, total);
+      LogPercent("Stop", residency.stop_cycles, total);
+      DebugLog("at ");
+      DebugLogUInt32(ClockGetSystemRate() / 1000000);
+      DebugLog("MHz\n");
+    }
+  }
+}
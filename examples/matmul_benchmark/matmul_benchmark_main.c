@@ -14,6 +14,7 @@ limitations under the License.
 
 #include "adc.h"
 #include "debug_log.h"
+#include "timebase.h"
 
 #define ADC_LOG_LENGTH (256)
 
@@ -117,13 +118,13 @@ static inline void BenchmarkSmallReferenceGemm() {
 
   const int repetitions = 1000;
   uint8_t c_data[8];
-  volatile uint16_t start_time = TimerGetCounter(TIMERID_TIM1);
+  volatile uint32_t start_time = TimebaseGet32();
   for (int i = 0; i < repetitions; ++i) {
     ReferenceEightBitIntGemm(0, 0, 0, a_rows, b_cols, a_cols, a_data, 0, a_cols,
                              b_data, 0, b_cols, c_data, 0, 1, 0, c_cols);
   }
-  volatile uint16_t duration = TimerGetCounter(TIMERID_TIM1) - start_time;
-  const int32_t microseconds_per_gemm = (duration * 1000) / repetitions;
+  volatile uint32_t duration = TimebaseGet32() - start_time;
+  const int32_t microseconds_per_gemm = duration / repetitions;
   const int32_t op_count = a_rows * b_cols * a_cols * 2;
   const int32_t ops_per_second = (op_count * 1000000) / microseconds_per_gemm;
   char adc_log[ADC_LOG_LENGTH];
@@ -176,13 +177,13 @@ static inline void BenchmarkReferenceGemm(int m, int n, int k) {
   uint8_t c_data[c_rows * c_cols * 10];
 
   const int repetitions = 1000;
-  const uint16_t start_time = TimerGetCounter(TIMERID_TIM1);
+  const uint32_t start_time = TimebaseGet32();
   for (int i = 0; i < repetitions; ++i) {
     ReferenceEightBitIntGemm(0, 0, 0, a_rows, b_cols, a_cols, a_data, 0, a_cols,
                              b_data, 0, b_cols, c_data, 0, 1, 0, c_cols);
   }
-  const uint16_t duration = TimerGetCounter(TIMERID_TIM1) - start_time;
-  const int32_t microseconds_per_gemm = (duration * 1000) / repetitions;
+  const uint32_t duration = TimebaseGet32() - start_time;
+  const int32_t microseconds_per_gemm = duration / repetitions;
   const int32_t op_count = a_rows * b_cols * a_cols * 2;
   const int32_t ops_per_second =
       ((op_count * 1000) / microseconds_per_gemm) * 1000;
@@ -206,7 +207,7 @@ void main(void) {
   // Start up the clock system.
   RccInitForAdc();
 
-  TimerInit(TIMERID_TIM1);
+  TimebaseInit();
 
   BenchmarkSmallReferenceGemm();
 
@@ -0,0 +1,161 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Breaks down where the cycles go in small matrix multiplications, using the
+// DWT performance counters. Each shape is run with its B matrix in SRAM and
+// then in flash, to show the extra load and fetch stalls that flash adds.
+
+#include "adc.h"
+#include "debug_log.h"
+#include "perf_counters.h"
+
+#define MAX_SIZE (16)
+#define REPETITIONS (1000)
+
+static uint8_t g_a_data[MAX_SIZE * MAX_SIZE];
+static uint8_t g_b_data[MAX_SIZE * MAX_SIZE];
+static uint8_t g_c_data[MAX_SIZE * MAX_SIZE];
+
+// Laid out the same as g_b_data, but left in flash.
+#define B_VALUE(i) ((uint8_t)((i) * 7))
+#define B_ROW(i)                                                      \
+  B_VALUE((i) + 0), B_VALUE((i) + 1), B_VALUE((i) + 2), B_VALUE((i) + 3), \
+      B_VALUE((i) + 4), B_VALUE((i) + 5), B_VALUE((i) + 6),               \
+      B_VALUE((i) + 7), B_VALUE((i) + 8), B_VALUE((i) + 9),               \
+      B_VALUE((i) + 10), B_VALUE((i) + 11), B_VALUE((i) + 12),            \
+      B_VALUE((i) + 13), B_VALUE((i) + 14), B_VALUE((i) + 15)
+static const uint8_t g_b_flash_data[MAX_SIZE * MAX_SIZE] = {
+    B_ROW(0),   B_ROW(16),  B_ROW(32),  B_ROW(48),  B_ROW(64),  B_ROW(80),
+    B_ROW(96),  B_ROW(112), B_ROW(128), B_ROW(144), B_ROW(160), B_ROW(176),
+    B_ROW(192), B_ROW(208), B_ROW(224), B_ROW(240),
+};
+
+// A plain row-major uint8 GEMM, c = (a * b) >> shift, with no offsets.
+//
+// Even at the largest size, a single output takes well under 256 load,
+// store and multi-cycle instruction stalls, but a whole matrix takes
+// thousands, so the session is updated after every output to stop the 8-bit
+// counters wrapping in between.
+static void SimpleGemm(int m, int n, int k, const uint8_t* a, const uint8_t* b,
+                       uint8_t* c, int shift, PerfCounterSession* session) {
+  for (int i = 0; i < m; ++i) {
+    for (int j = 0; j < n; ++j) {
+      int32_t total = 0;
+      for (int l = 0; l < k; ++l) {
+        total += a[(i * k) + l] * b[(l * n) + j];
+      }
+      int32_t output = total >> shift;
+      if (output > 255) {
+        output = 255;
+      }
+      c[(i * n) + j] = output;
+      PerfCountersUpdate(session);
+    }
+  }
+}
+
+// What OVERHEAD_UPDATES calls to PerfCountersUpdate() cost on their own.
+#define OVERHEAD_UPDATES (1000)
+static PerfCounts g_update_overhead;
+
+static void MeasureUpdateOverhead(void) {
+  PerfCounterSession session;
+  PerfCountersStart(&session, PERF_COUNTER_ALL);
+  for (int i = 0; i < OVERHEAD_UPDATES; ++i) {
+    PerfCountersUpdate(&session);
+  }
+  PerfCountersStop(&session, &g_update_overhead);
+  PerfCountsLog("1000 updates", &g_update_overhead);
+}
+
+// Takes away the share of the update overhead from one of the totals.
+static uint32_t SubtractOverhead(uint32_t total, uint32_t overhead,
+                                 uint32_t update_count) {
+  const uint64_t share =
+      ((uint64_t)(overhead) * update_count) / OVERHEAD_UPDATES;
+  if (share > total) {
+    return 0;
+  }
+  return total - (uint32_t)(share);
+}
+
+static void BenchmarkGemm(int size, const uint8_t* b, char* b_location) {
+  PerfCounterSession session;
+  PerfCountersStart(&session, PERF_COUNTER_ALL);
+  for (int i = 0; i < REPETITIONS; ++i) {
+    SimpleGemm(size, size, size, g_a_data, b, g_c_data, 8, &session);
+  }
+  PerfCounts counts;
+  PerfCountersStop(&session, &counts);
+
+  // Remove the cost of the updates themselves, so the counts are for the
+  // multiplications alone.
+  const uint32_t update_count = REPETITIONS * size * size;
+  const PerfCounts* overhead = &g_update_overhead;
+  const uint64_t overhead_cycles =
+      (overhead->cycles * update_count) / OVERHEAD_UPDATES;
+  counts.cycles = (overhead_cycles < counts.cycles)
+                      ? (counts.cycles - overhead_cycles)
+                      : 0;
+  counts.cpi_cycles =
+      SubtractOverhead(counts.cpi_cycles, overhead->cpi_cycles, update_count);
+  counts.exception_cycles = SubtractOverhead(
+      counts.exception_cycles, overhead->exception_cycles, update_count);
+  counts.sleep_cycles = SubtractOverhead(
+      counts.sleep_cycles, overhead->sleep_cycles, update_count);
+  counts.lsu_cycles =
+      SubtractOverhead(counts.lsu_cycles, overhead->lsu_cycles, update_count);
+  counts.folded_count = SubtractOverhead(
+      counts.folded_count, overhead->folded_count, update_count);
+
+  DebugLog("Gemm(");
+  DebugLogInt32(size);
+  DebugLog(") with B in ");
+  DebugLog(b_location);
+  DebugLog(", ");
+  DebugLogInt32(REPETITIONS);
+  DebugLog(" repetitions\n");
+  PerfCountsLog("  totals", &counts);
+  DebugLog("  cycles per gemm: ");
+  DebugLogUInt32((uint32_t)(counts.cycles / REPETITIONS));
+  DebugLog(", LSU stall cycles per gemm: ");
+  DebugLogUInt32(counts.lsu_cycles / REPETITIONS);
+  DebugLog("\n");
+}
+
+void main(void) {
+  RccInitForAdc();
+
+  if (!PerfCountersInit()) {
+    DebugLog("No cycle counter available\n");
+    return;
+  }
+
+  for (int i = 0; i < (MAX_SIZE * MAX_SIZE); ++i) {
+    g_a_data[i] = i * 3;
+    g_b_data[i] = B_VALUE(i);
+  }
+
+  // Measures what an empty session costs, so it can be taken into account.
+  PerfCounterSession session;
+  PerfCounts overhead;
+  PerfCountersStart(&session, PERF_COUNTER_ALL);
+  PerfCountersStop(&session, &overhead);
+  PerfCountsLog("Empty session", &overhead);
+  MeasureUpdateOverhead();
+
+  const int sizes[] = {2, 4, 8, 16};
+  for (int i = 0; i < (sizeof(sizes) / sizeof(sizes[0])); ++i) {
+    BenchmarkGemm(sizes[i], g_b_data, "SRAM");
+    BenchmarkGemm(sizes[i], g_b_flash_data, "flash");
+  }
+}
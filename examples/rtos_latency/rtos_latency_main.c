@@ -0,0 +1,210 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Measures the preemptive kernel's latencies in cycles, while a long
+// low-priority computation keeps the processor busy.
+//
+// - A 1kHz TIM3 interrupt wakes the most urgent task through a semaphore,
+//   which records how long it took from the handler to the task.
+// - A ping task wakes a more urgent pong task the same way, which records
+//   the task-to-task switch time.
+// - A pretend inference task runs matrix multiplies in the background, and
+//   only gets the processor when nothing else needs it.
+//
+// The tasks share the debug log through a mutex, so when the inference task
+// is holding it, the urgent tasks lend it their priority until it's done.
+
+#include "clocks.h"
+#include "debug_log.h"
+#include "interrupts.h"
+#include "kernel.h"
+#include "power.h"
+#include "timers.h"
+
+#define TICK_RATE (1000)
+#define SENSOR_RATE (1000)
+#define STACK_WORDS (256)
+#define SAMPLES_PER_LOG (2000)
+
+#define SENSOR_PRIORITY (0)
+#define PONG_PRIORITY (1)
+#define PING_PRIORITY (2)
+#define INFERENCE_PRIORITY (10)
+
+#define MATRIX_SIZE (16)
+
+typedef struct {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+} LatencyStats;
+
+static KernelTask g_sensor_task;
+static KernelTask g_ping_task;
+static KernelTask g_pong_task;
+static KernelTask g_inference_task;
+static uint32_t g_sensor_stack[STACK_WORDS];
+static uint32_t g_ping_stack[STACK_WORDS];
+static uint32_t g_pong_stack[STACK_WORDS];
+static uint32_t g_inference_stack[STACK_WORDS];
+
+static KernelSemaphore g_sensor_ready;
+static KernelSemaphore g_pong_ready;
+static KernelMutex g_log_mutex;
+
+// The cycle counter when each wakeup was triggered.
+static volatile uint32_t g_interrupt_cycles;
+static volatile uint32_t g_ping_cycles;
+
+static volatile uint32_t g_inference_count = 0;
+
+static void ResetStats(LatencyStats* stats) {
+  stats->count = 0;
+  stats->min = 0xffffffff;
+  stats->max = 0;
+  stats->total = 0;
+}
+
+static void AddSample(LatencyStats* stats, uint32_t cycles) {
+  ++stats->count;
+  if (cycles < stats->min) {
+    stats->min = cycles;
+  }
+  if (cycles > stats->max) {
+    stats->max = cycles;
+  }
+  stats->total += cycles;
+}
+
+static void LogStats(char* label, LatencyStats* stats) {
+  KernelMutexLock(&g_log_mutex);
+  DebugLog(label);
+  DebugLog(" cycles: min ");
+  DebugLogUInt32(stats->min);
+  DebugLog(", mean ");
+  DebugLogUInt32((uint32_t)(stats->total / stats->count));
+  DebugLog(", max ");
+  DebugLogUInt32(stats->max);
+  DebugLog("\n");
+  KernelMutexUnlock(&g_log_mutex);
+  ResetStats(stats);
+}
+
+void OnTim3Interrupt() {
+  TIM3->SR = ~TIM_SR_UIF;
+  g_interrupt_cycles = DWT->CYCCNT;
+  KernelSemaphoreGive(&g_sensor_ready);
+}
+
+// Sends the kernel's context switches to it.
+__attribute__((naked)) void OnPendSV() { __asm("b KernelPendSV"); }
+
+static void SensorTask(void* arg) {
+  LatencyStats stats;
+  ResetStats(&stats);
+  while (1) {
+    KernelSemaphoreTake(&g_sensor_ready);
+    AddSample(&stats, DWT->CYCCNT - g_interrupt_cycles);
+    if (stats.count == SAMPLES_PER_LOG) {
+      LogStats("Interrupt to task", &stats);
+      KernelMutexLock(&g_log_mutex);
+      DebugLog("Inference runs: ");
+      DebugLogUInt32(g_inference_count);
+      DebugLog(", sensor stack used: ");
+      DebugLogUInt32(KernelTaskStackUsed(&g_sensor_task));
+      DebugLog(" words\n");
+      KernelMutexUnlock(&g_log_mutex);
+    }
+  }
+}
+
+static void PongTask(void* arg) {
+  LatencyStats stats;
+  ResetStats(&stats);
+  while (1) {
+    KernelSemaphoreTake(&g_pong_ready);
+    AddSample(&stats, DWT->CYCCNT - g_ping_cycles);
+    if (stats.count == SAMPLES_PER_LOG) {
+      LogStats("Task to task", &stats);
+    }
+  }
+}
+
+static void PingTask(void* arg) {
+  while (1) {
+    KernelSleep(1);
+    g_ping_cycles = DWT->CYCCNT;
+    KernelSemaphoreGive(&g_pong_ready);
+  }
+}
+
+static void InferenceTask(void* arg) {
+  static uint8_t a[MATRIX_SIZE * MATRIX_SIZE];
+  static uint8_t b[MATRIX_SIZE * MATRIX_SIZE];
+  static int32_t c[MATRIX_SIZE * MATRIX_SIZE];
+  for (int i = 0; i < (MATRIX_SIZE * MATRIX_SIZE); ++i) {
+    a[i] = i;
+    b[i] = i * 3;
+  }
+  while (1) {
+    for (int i = 0; i < MATRIX_SIZE; ++i) {
+      for (int j = 0; j < MATRIX_SIZE; ++j) {
+        int32_t total = 0;
+        for (int k = 0; k < MATRIX_SIZE; ++k) {
+          total += a[(i * MATRIX_SIZE) + k] * b[(k * MATRIX_SIZE) + j];
+        }
+        c[(i * MATRIX_SIZE) + j] = total;
+      }
+    }
+    ++g_inference_count;
+    // Hold the log for a while now and again, so the more urgent tasks
+    // sometimes have to wait for it.
+    if ((g_inference_count % 1000) == 0) {
+      KernelMutexLock(&g_log_mutex);
+      DebugLog("Inference result: ");
+      DebugLogInt32(c[0]);
+      DebugLog("\n");
+      KernelMutexUnlock(&g_log_mutex);
+    }
+  }
+}
+
+void main(void) {
+  ClockInitProfile(CLOCK_PROFILE_72MHZ);
+  PowerInit();
+
+  KernelInit();
+  KernelSemaphoreInit(&g_sensor_ready, 0);
+  KernelSemaphoreInit(&g_pong_ready, 0);
+  KernelMutexInit(&g_log_mutex);
+  KernelCreateTask(&g_sensor_task, SENSOR_PRIORITY, SensorTask, 0,
+                   g_sensor_stack, STACK_WORDS);
+  KernelCreateTask(&g_pong_task, PONG_PRIORITY, PongTask, 0, g_pong_stack,
+                   STACK_WORDS);
+  KernelCreateTask(&g_ping_task, PING_PRIORITY, PingTask, 0, g_ping_stack,
+                   STACK_WORDS);
+  KernelCreateTask(&g_inference_task, INFERENCE_PRIORITY, InferenceTask, 0,
+                   g_inference_stack, STACK_WORDS);
+
+  TimerInitForRate(TIMERID_TIM3, SENSOR_RATE,
+                   TimerGetClockRate(TIMERID_TIM3));
+  TIM3->SR = 0;
+  TIM3->DIER = TIM_DIER_UIE;
+  // The sensor interrupt preempts everything else, and the kernel's own
+  // PendSV and SysTick are already the least urgent.
+  InterruptSetPriority(TIM3_IRQn, INTERRUPT_PRIORITY_HIGHEST, 0);
+  InterruptEnable(TIM3_IRQn);
+  TIM3->CR1 |= TIM_CR1_CEN;
+
+  KernelStart(TICK_RATE);
+}
@@ -0,0 +1,113 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Runs a few independent activities with the cooperative scheduler: the LED
+// blinks, a pretend sensor is polled, and statistics are logged, each at its
+// own rate, with a one-shot task that changes the blink rate part way
+// through. Between tasks the processor sleeps until the next deadline, with
+// no regular tick, so the log shows how few times it had to wake up.
+
+#include "clocks.h"
+#include "debug_log.h"
+#include "delay.h"
+#include "led.h"
+#include "power.h"
+#include "scheduler.h"
+#include "timebase.h"
+
+#define MAX_TASKS (8)
+
+#define BLINK_PERIOD_US (500 * 1000)
+#define FAST_BLINK_PERIOD_US (100 * 1000)
+#define SENSOR_PERIOD_US (20 * 1000)
+#define LOG_PERIOD_US (2 * 1000 * 1000)
+#define SPEED_UP_DELAY_US (5 * 1000 * 1000)
+
+// How long a sensor poll pretends to take.
+#define SENSOR_CYCLES (5000)
+
+static Scheduler g_scheduler;
+static SchedulerTask* g_heap[MAX_TASKS];
+
+static SchedulerTask g_blink_task;
+static SchedulerTask g_sensor_task;
+static SchedulerTask g_log_task;
+static SchedulerTask g_speed_up_task;
+
+static int g_is_led_on = 0;
+static uint32_t g_sensor_total = 0;
+
+static void Blink(void* arg) {
+  g_is_led_on = !g_is_led_on;
+  if (g_is_led_on) {
+    LedOn();
+  } else {
+    LedOff();
+  }
+}
+
+static void PollSensor(void* arg) {
+  DelayCycles(SENSOR_CYCLES);
+  g_sensor_total += DWT->CYCCNT & 0xff;
+}
+
+static void LogTask(char* name, const SchedulerTask* task) {
+  DebugLog(name);
+  DebugLog(": ");
+  DebugLogUInt32(task->run_count);
+  DebugLog(" runs, ");
+  DebugLogUInt32(task->skipped_count);
+  DebugLog(" skipped, ");
+  DebugLogUInt32(task->max_lateness);
+  DebugLog("us max lateness\n");
+}
+
+static void LogStats(void* arg) {
+  LogTask("Blink", &g_blink_task);
+  LogTask("Sensor", &g_sensor_task);
+  LogTask("Log", &g_log_task);
+  PowerResidency residency;
+  PowerGetResidency(&residency);
+  PowerResetResidency();
+  DebugLog("Slept ");
+  DebugLogUInt32(g_scheduler.sleep_count);
+  DebugLog(" times, awake ");
+  DebugLogUInt32(PowerAwakePermille(&residency));
+  DebugLog(" permille of the time\n");
+}
+
+static void SpeedUp(void* arg) {
+  DebugLog("Speeding up the blink\n");
+  SchedulerAddPeriodic(&g_scheduler, &g_blink_task, Blink, 0,
+                       FAST_BLINK_PERIOD_US);
+}
+
+void main(void) {
+  ClockInitProfile(CLOCK_PROFILE_72MHZ);
+  LedInit();
+  PowerInit();
+  TimebaseInit();
+
+  SchedulerInit(&g_scheduler, g_heap, MAX_TASKS);
+  SchedulerAddPeriodic(&g_scheduler, &g_blink_task, Blink, 0,
+                       BLINK_PERIOD_US);
+  SchedulerAddPeriodic(&g_scheduler, &g_sensor_task, PollSensor, 0,
+                       SENSOR_PERIOD_US);
+  SchedulerAddPeriodic(&g_scheduler, &g_log_task, LogStats, 0,
+                       LOG_PERIOD_US);
+  SchedulerAddOneShot(&g_scheduler, &g_speed_up_task, SpeedUp, 0,
+                      SPEED_UP_DELAY_US);
+
+  while (1) {
+    SchedulerRunOnce(&g_scheduler);
+  }
+}
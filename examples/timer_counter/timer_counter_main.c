@@ -14,17 +14,17 @@ limitations under the License.
 
 #include "adc.h"
 #include "debug_log.h"
+#include "timebase.h"
 
 void main(void) {
   // Start up the clock system.
   RccInitForAdc();
 
-  TimerInit(TIMERID_TIM1);
-  const uint16_t start_time = TimerGetCounter(TIMERID_TIM1);
+  TimebaseInit();
   while (1) {
-    const uint16_t current_time = TimerGetCounter(TIMERID_TIM1) - start_time;
-    const int32_t seconds = current_time / 1000;
-    const int32_t milliseconds = current_time - (seconds * 1000);
+    const uint64_t current_time = TimebaseGet64() / 1000;
+    const int32_t seconds = (int32_t)(current_time / 1000);
+    const int32_t milliseconds = (int32_t)(current_time - (seconds * 1000));
     const int32_t adc_log_length = 256;
     char adc_log[adc_log_length];
     StrCpy(adc_log, adc_log_length, "Time: ");
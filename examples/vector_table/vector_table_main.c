@@ -0,0 +1,82 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Installs interrupt handlers at runtime, by moving the vector table into
+// SRAM. TIM3's interrupt is pended from software, first with the handler
+// linked into the flash table, then with one installed in the SRAM copy,
+// and then with a second one swapped in, and the cycles from pending the
+// interrupt to reaching the handler are logged for each. With the table in
+// SRAM, fetching the vector doesn't have to wait for flash.
+
+#include "clocks.h"
+#include "debug_log.h"
+#include "delay.h"
+#include "vector_table.h"
+
+#define REPETITIONS (1000)
+
+static volatile uint32_t g_pend_cycles;
+static volatile uint32_t g_latency_total;
+static volatile uint32_t g_first_count;
+static volatile uint32_t g_second_count;
+
+// The handler linked into the flash table.
+void OnTim3Interrupt() {
+  g_latency_total += DWT->CYCCNT - g_pend_cycles;
+}
+
+static void FirstHandler(void) {
+  g_latency_total += DWT->CYCCNT - g_pend_cycles;
+  ++g_first_count;
+}
+
+static void SecondHandler(void) {
+  g_latency_total += DWT->CYCCNT - g_pend_cycles;
+  ++g_second_count;
+}
+
+static void MeasureLatency(char* label) {
+  g_latency_total = 0;
+  for (int i = 0; i < REPETITIONS; ++i) {
+    g_pend_cycles = DWT->CYCCNT;
+    NVIC_SetPendingIRQ(TIM3_IRQn);
+    // Give the interrupt time to be taken before the next one.
+    DelayCycles(100);
+  }
+  DebugLog(label);
+  DebugLog(": ");
+  DebugLogUInt32(g_latency_total / REPETITIONS);
+  DebugLog(" cycles from pending to handler\n");
+}
+
+void main(void) {
+  ClockInitProfile(CLOCK_PROFILE_72MHZ);
+  DelayEnableCycleCounter();
+  NVIC_EnableIRQ(TIM3_IRQn);
+
+  MeasureLatency("Flash table");
+
+  VectorTableSetHandler(TIM3_IRQn, FirstHandler);
+  MeasureLatency("SRAM table, first handler");
+
+  const VectorHandler previous =
+      VectorTableSetHandler(TIM3_IRQn, SecondHandler);
+  MeasureLatency("SRAM table, second handler");
+
+  DebugLog("First handler ran ");
+  DebugLogUInt32(g_first_count);
+  DebugLog(" times, second ran ");
+  DebugLogUInt32(g_second_count);
+  DebugLog(" times, and was ");
+  DebugLog((previous == FirstHandler) ? "swapped in correctly\n"
+                                      : "not swapped in correctly\n");
+}
@@ -0,0 +1,115 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// This example shows how to use voice activity detection to skip expensive
+// processing while a microphone is only hearing background noise. The LED is
+// lit while voice is detected, and the debug log shows what fraction of
+// blocks needed the full pipeline.
+
+#include "adc.h"
+#include "biquad.h"
+#include "debug_log.h"
+#include "led.h"
+#include "signal_stats.h"
+#include "vad.h"
+
+#define DMA_BUFFER_SIZE (1024)
+#define BLOCK_SIZE (DMA_BUFFER_SIZE / 2)
+uint16_t g_dma_buffer[DMA_BUFFER_SIZE];
+
+int32_t g_error_count;
+int32_t g_processed_count;
+
+SignalStatsTracker g_stats_tracker;
+VoiceActivityDetector g_vad;
+
+// A band-pass for the main speech frequencies, standing in for the feature
+// extraction that a real application would gate on the detector. These are
+// the high-pass and low-pass sections from examples/biquad_benchmark.
+#define SECTION_COUNT (2)
+#define COEFFICIENT_COUNT (SECTION_COUNT * BIQUAD_COEFFICIENT_COUNT)
+static const int16_t g_coefficients[COEFFICIENT_COUNT] = {
+    15950, -31900, 15950, 31888, -15527,  // 100Hz high-pass.
+    4554,  9107,   4554,  992,   -2822,   // 4KHz low-pass.
+};
+int32_t g_filter_state[4 * SECTION_COUNT];
+BiquadCascade g_filter;
+
+void main(void) {
+  g_error_count = 0;
+  g_processed_count = 0;
+  SignalStatsInit(&g_stats_tracker, BLOCK_SIZE, 3);
+  VadInit(&g_vad, VAD_DEFAULT_THRESHOLD_RATIO_Q8, VAD_DEFAULT_MIN_RMS,
+          VAD_DEFAULT_MAX_ZERO_CROSSING_RATE, VAD_DEFAULT_HANGOVER_BLOCKS);
+  BiquadCascadeInit(&g_filter, BIQUAD_DIRECT_FORM_1, g_coefficients,
+                    SECTION_COUNT, 1, 1, g_filter_state);
+
+  // Start up the clock system.
+  RccInitForAdc();
+
+  // TODO: At the moment, only port A0 seems to be working.
+  AdcInit(GPIOA, 0, 0);
+  DmaInit();
+  AdcDmaOn(g_dma_buffer, DMA_BUFFER_SIZE);
+  LedInit();
+  while (1) {
+    if (g_vad.is_active) {
+      LedOn();
+    } else {
+      LedOff();
+    }
+    const int32_t duty_percent =
+        (VadGetDutyCycle(&g_vad) * 100) / VAD_DUTY_CYCLE_ONE;
+    const int32_t vad_log_length = 256;
+    char vad_log[vad_log_length];
+    StrCpy(vad_log, vad_log_length, "VAD: ");
+    StrCatInt32(vad_log, vad_log_length, duty_percent);
+    StrCatStr(vad_log, vad_log_length, "% active, ");
+    StrCatInt32(vad_log, vad_log_length, g_processed_count);
+    StrCatStr(vad_log, vad_log_length, " blocks processed, noise floor ");
+    StrCatInt32(vad_log, vad_log_length, g_vad.noise_floor_q8 >> 8);
+    StrCatStr(vad_log, vad_log_length, ", ");
+    StrCatInt32(vad_log, vad_log_length, g_error_count);
+    StrCatStr(vad_log, vad_log_length, " errors\n");
+    DebugLog(vad_log);
+  }
+  AdcOff();
+}
+
+void ProcessDmaBuffer(uint16_t* block) {
+  SignalStats stats;
+  SignalStatsProcessAdc(&g_stats_tracker, block, &stats);
+  if (!VadUpdate(&g_vad, &stats)) {
+    return;
+  }
+  // Only blocks that might contain voice get this far.
+  BiquadCascadeProcessAdc(&g_filter, block, BLOCK_SIZE);
+  ++g_processed_count;
+}
+
+void OnDma1Channel1Interrupt() {
+  if (DMA1->ISR & DMA_ISR_TEIF1) {
+    ++g_error_count;
+    DMA1->IFCR |= DMA_IFCR_CTEIF1;
+    return;
+  }
+  if (DMA1->ISR & DMA_ISR_HTIF1) {
+    DMA1->IFCR |= DMA_IFCR_CHTIF1;
+    ProcessDmaBuffer(g_dma_buffer);
+    return;
+  }
+  if (DMA1->ISR & DMA_ISR_TCIF1) {
+    DMA1->IFCR |= DMA_IFCR_CTCIF1;
+    ProcessDmaBuffer(g_dma_buffer + BLOCK_SIZE);
+    return;
+  }
+}
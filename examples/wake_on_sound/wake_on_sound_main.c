@@ -0,0 +1,210 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// This example shows how to listen for sounds on a microphone connected to
+// pin A0 while the CPU spends most of its time asleep. The ADC keeps
+// converting, but nothing reads the results while it's quiet. Instead the
+// analog watchdog checks every sample against a window around the midpoint,
+// and only wakes the CPU when one falls outside it. Then DMA captures and
+// processes blocks of audio until things go quiet again, with the LED lit.
+// The log shows what fraction of the time was spent asleep.
+
+#include "adc.h"
+#include "debug_log.h"
+#include "interrupts.h"
+#include "led.h"
+#include "signal_stats.h"
+#include "timebase.h"
+
+// How far from the midpoint a sample has to be to wake us up, in raw ADC
+// units. This depends on the microphone's gain and the background noise.
+#define WAKE_THRESHOLD (200)
+#define WATCHDOG_LOW (2048 - WAKE_THRESHOLD)
+#define WATCHDOG_HIGH (2048 + WAKE_THRESHOLD)
+
+// How many blocks in a row have to stay inside the window before we stop
+// capturing and go back to sleep.
+#define QUIET_BLOCKS_TO_STOP (8)
+
+// SysTick wakes us a few times a second, so we can log even when nothing is
+// happening. Its counter is only 24 bits, so at 72MHz it can't go much slower
+// than this.
+#define TICKS_PER_SECOND (8)
+
+#define DMA_BUFFER_SIZE (1024)
+#define BLOCK_SIZE (DMA_BUFFER_SIZE / 2)
+uint16_t g_dma_buffer[DMA_BUFFER_SIZE];
+
+volatile int g_watchdog_fired;
+volatile int g_capture_done;
+int32_t g_quiet_block_count;
+int32_t g_error_count;
+int32_t g_wake_count;
+int32_t g_captured_block_count;
+
+SignalStatsTracker g_stats_tracker;
+SignalStats g_stats;
+
+// Time spent in each mode, in microseconds.
+uint64_t g_sleep_time;
+uint64_t g_active_time;
+uint32_t g_last_time;
+
+// Adds the time since the last call to the given total.
+static void AccountTime(uint64_t* total) {
+  const uint32_t now = TimebaseGet32();
+  *total += now - g_last_time;
+  g_last_time = now;
+}
+
+// Sleeps until the watchdog spots a sound, or a second has passed.
+static void SleepUntilSound(void) {
+  AccountTime(&g_active_time);
+  g_watchdog_fired = 0;
+  AdcWatchdogArm();
+  const uint32_t end_tick = g_tick_count + TICKS_PER_SECOND;
+  // Interrupts are masked while we check the flag, so one can't sneak in
+  // between the check and the WFI. WFI still wakes on a pending interrupt
+  // while they're masked, and it's handled as soon as they're unmasked.
+  __disable_irq();
+  while (!g_watchdog_fired && ((int32_t)(end_tick - g_tick_count) > 0)) {
+    __WFI();
+    __enable_irq();
+    __disable_irq();
+  }
+  __enable_irq();
+  AdcWatchdogDisarm();
+  AccountTime(&g_sleep_time);
+}
+
+// Captures and processes blocks until the signal has been quiet for a while.
+// The CPU still sleeps between blocks, but this all counts as active time,
+// since it's what a real application would spend running inference.
+static void CaptureUntilQuiet(void) {
+  ++g_wake_count;
+  LedOn();
+  g_capture_done = 0;
+  g_quiet_block_count = 0;
+  DMA1->IFCR = DMA_IFCR_CGIF1;
+  AdcDmaOn(g_dma_buffer, DMA_BUFFER_SIZE);
+  __disable_irq();
+  while (!g_capture_done) {
+    __WFI();
+    __enable_irq();
+    __disable_irq();
+  }
+  __enable_irq();
+  DMA1->CCR1 &= ~DMA_CCR_EN;
+  LedOff();
+  AccountTime(&g_active_time);
+}
+
+void main(void) {
+  g_error_count = 0;
+  g_wake_count = 0;
+  g_captured_block_count = 0;
+  g_sleep_time = 0;
+  g_active_time = 0;
+  SignalStatsInit(&g_stats_tracker, BLOCK_SIZE, 3);
+
+  // Start up the clock system.
+  RccInitForAdc();
+  g_tick_count = 0;
+  SysTick_Config(ClockGetHclkRate() / TICKS_PER_SECOND);
+  TimebaseInit();
+  g_last_time = TimebaseGet32();
+  LedInit();
+
+  // The block processing runs in the DMA handler, so give it the least
+  // urgent priority, and let the watchdog that starts a capture, and the
+  // timekeeping interrupts, preempt it.
+  InterruptSetPriority(ADC1_2_IRQn, INTERRUPT_PRIORITY_HIGHEST, 0);
+  InterruptSetPriority(SysTick_IRQn, 1, 0);
+  TimebaseSetInterruptPriority(1);
+  InterruptSetPriority(DMA1_Channel1_IRQn, InterruptLowestPreemptPriority(),
+                       0);
+
+  // The ADC free-runs the whole time, but DMA is only enabled while we're
+  // capturing.
+  AdcInit(GPIOA, 0, 0);
+  DmaInit();
+  AdcWatchdogInit(0, WATCHDOG_LOW, WATCHDOG_HIGH);
+  while (1) {
+    SleepUntilSound();
+    if (g_watchdog_fired) {
+      CaptureUntilQuiet();
+    }
+
+    const uint64_t total_time = g_sleep_time + g_active_time;
+    int32_t sleep_percent = 0;
+    if (total_time > 0) {
+      sleep_percent = (int32_t)((g_sleep_time * 100) / total_time);
+    }
+    const int32_t adc_log_length = 256;
+    char adc_log[adc_log_length];
+    StrCpy(adc_log, adc_log_length, "Wake on sound: ");
+    StrCatInt32(adc_log, adc_log_length, sleep_percent);
+    StrCatStr(adc_log, adc_log_length, "% asleep, ");
+    StrCatInt32(adc_log, adc_log_length, (int32_t)(g_sleep_time / 1000));
+    StrCatStr(adc_log, adc_log_length, "ms sleeping, ");
+    StrCatInt32(adc_log, adc_log_length, (int32_t)(g_active_time / 1000));
+    StrCatStr(adc_log, adc_log_length, "ms active, ");
+    StrCatInt32(adc_log, adc_log_length, g_wake_count);
+    StrCatStr(adc_log, adc_log_length, " wakes, ");
+    StrCatInt32(adc_log, adc_log_length, g_captured_block_count);
+    StrCatStr(adc_log, adc_log_length, " blocks, ");
+    StrCatInt32(adc_log, adc_log_length, g_error_count);
+    StrCatStr(adc_log, adc_log_length, " errors\n");
+    DebugLog(adc_log);
+  }
+  AdcOff();
+}
+
+// Stands in for the real processing, and decides when to stop capturing.
+void ProcessDmaBuffer(const uint16_t* block) {
+  ++g_captured_block_count;
+  SignalStatsProcessAdc(&g_stats_tracker, block, &g_stats);
+  if ((g_stats.min < WATCHDOG_LOW) || (g_stats.max > WATCHDOG_HIGH)) {
+    g_quiet_block_count = 0;
+  } else {
+    ++g_quiet_block_count;
+    if (g_quiet_block_count >= QUIET_BLOCKS_TO_STOP) {
+      g_capture_done = 1;
+    }
+  }
+}
+
+void OnAdcInterrupt() {
+  if (AdcWatchdogTriggered()) {
+    AdcWatchdogDisarm();
+    g_watchdog_fired = 1;
+  }
+}
+
+void OnDma1Channel1Interrupt() {
+  if (DMA1->ISR & DMA_ISR_TEIF1) {
+    ++g_error_count;
+    DMA1->IFCR |= DMA_IFCR_CTEIF1;
+    g_capture_done = 1;
+    return;
+  }
+  if (DMA1->ISR & DMA_ISR_HTIF1) {
+    DMA1->IFCR |= DMA_IFCR_CHTIF1;
+    ProcessDmaBuffer(g_dma_buffer);
+    return;
+  }
+  if (DMA1->ISR & DMA_ISR_TCIF1) {
+    DMA1->IFCR |= DMA_IFCR_CTCIF1;
+    ProcessDmaBuffer(g_dma_buffer + BLOCK_SIZE);
+    return;
+  }
+}
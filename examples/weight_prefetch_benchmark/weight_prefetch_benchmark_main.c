@@ -0,0 +1,110 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Times a small eight-bit GEMM, like a fully-connected layer, with its
+// weights read straight from flash, and then with them prefetched into SRAM
+// a tile at a time by DMA. Timings are in processor cycles, from the DWT
+// cycle counter.
+
+#include "adc.h"
+#include "debug_log.h"
+#include "weight_prefetch.h"
+
+// The number of input vectors, the length of each, and the number of
+// outputs for each input.
+#define INPUT_COUNT (4)
+#define DEPTH (256)
+#define OUTPUT_COUNT (64)
+
+// Each row holds the weights for one output. Being const, this array lives
+// in flash. Only the start is filled in to keep the source short, but the
+// timing doesn't depend on the values.
+const uint8_t g_weights[OUTPUT_COUNT * DEPTH] = {
+    3,  1,  4,  1,  5,  9,  2,  6,  5,  3,  5,  8,  9,  7,  9,  3,
+    2,  3,  8,  4,  6,  2,  6,  4,  3,  3,  8,  3,  2,  7,  9,  5,
+};
+
+uint8_t g_inputs[INPUT_COUNT * DEPTH];
+int32_t g_outputs[INPUT_COUNT * OUTPUT_COUNT];
+
+// Room for two tiles of four rows each.
+#define SCRATCH_BYTES (2 * 4 * DEPTH)
+uint32_t g_scratch[SCRATCH_BYTES / 4];
+
+#define REPETITIONS (10)
+
+static inline uint32_t GetCycles() { return DWT->CYCCNT; }
+
+// Calculates the outputs that depend on a tile of weight rows.
+static void GemmTile(const uint8_t* tile, int first_row, int row_count,
+                     void* arg) {
+  for (int row = 0; row < row_count; ++row) {
+    const uint8_t* weights = tile + (row * DEPTH);
+    for (int i = 0; i < INPUT_COUNT; ++i) {
+      const uint8_t* input = g_inputs + (i * DEPTH);
+      int32_t total = 0;
+      for (int d = 0; d < DEPTH; ++d) {
+        total += input[d] * weights[d];
+      }
+      g_outputs[(i * OUTPUT_COUNT) + first_row + row] = total;
+    }
+  }
+}
+
+static uint32_t Checksum() {
+  uint32_t checksum = 0;
+  for (int i = 0; i < (INPUT_COUNT * OUTPUT_COUNT); ++i) {
+    checksum = (checksum * 31) + g_outputs[i];
+  }
+  return checksum;
+}
+
+static void LogResult(char* label, uint32_t cycles, uint32_t checksum) {
+  DebugLog(label);
+  DebugLogUInt32(cycles / REPETITIONS);
+  DebugLog(" cycles per GEMM, checksum ");
+  DebugLogHex(checksum);
+  DebugLog("\n");
+}
+
+void main(void) {
+  // Runs the PLL with two flash wait states.
+  RccInitForAdc();
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  for (int i = 0; i < (INPUT_COUNT * DEPTH); ++i) {
+    g_inputs[i] = (i * 17) & 0xff;
+  }
+  DebugLog("Tiles of ");
+  DebugLogInt32(WeightPrefetchRowsPerTile(DEPTH, OUTPUT_COUNT, SCRATCH_BYTES));
+  DebugLog(" rows\n");
+
+  uint32_t start = GetCycles();
+  for (int i = 0; i < REPETITIONS; ++i) {
+    GemmTile(g_weights, 0, OUTPUT_COUNT, 0);
+  }
+  const uint32_t flash_cycles = GetCycles() - start;
+  LogResult("From flash: ", flash_cycles, Checksum());
+
+  start = GetCycles();
+  for (int i = 0; i < REPETITIONS; ++i) {
+    WeightPrefetchRun(g_weights, DEPTH, OUTPUT_COUNT, (uint8_t*)(g_scratch),
+                      SCRATCH_BYTES, GemmTile, 0);
+  }
+  const uint32_t prefetch_cycles = GetCycles() - start;
+  LogResult("Prefetched: ", prefetch_cycles, Checksum());
+
+  DebugLog("Speedup ");
+  DebugLogUInt32((flash_cycles * 100) / prefetch_cycles);
+  DebugLog("%\n");
+}
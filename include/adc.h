@@ -15,7 +15,9 @@ limitations under the License.
 #ifndef INCLUDE_ADC_H
 #define INCLUDE_ADC_H
 
+#include "clocks.h"
 #include "core_stm32.h"
+#include "delay.h"
 #include "timers.h"
 
 #ifdef __cplusplus
@@ -44,32 +46,24 @@ static inline void EnableNvic(int irq) {
 
 // Sets up the clock control system for ADC access.
 static inline void RccInitForAdc(void) {
-  // Here we're asking the chip to run at 72 MHz. The PLL controls the
-  // main chip's speed, so to get 72MHz we set the source of the PLL to
-  // be the HSE clock, which is 8MHz, with a multiplier of x9.
-  RCC->CFGR = RCC_CFGR_PLLSRC_HSE | RCC_CFGR_PLLMUL_9 | RCC_CFGR_SW_HSI |
-              RCC_CFGR_PPRE1_DIV_2;
-  RCC->CR = RCC_CR_HSION | RCC_CR_HSEON | RCC_CR_PLLON;
-  while (!(RCC->CR & RCC_CR_PLLRDY)) {
-  }
-
-  // Configure flash to work with the new speed, with prefetching enabled
-  // and a two-clock wait for access.
-  *FLASH_ACR = FLASH_ACR_PRFTBE | FLASH_ACR_LATENCY_2;
+  // Run the processor at the full 72MHz, from the 8MHz crystal with the PLL
+  // at x9, with two flash wait states.
+  ClockConfig config;
+  ClockGetProfile(CLOCK_PROFILE_72MHZ, &config);
 
   // The ADC clock speed is:
   // SYSCLOCK / AHB Prescaler / APB2 Prescaler / ADC Prescaler.
   // In this case, we want 16KHz for the ADC, so:
-  // 72MHz / 2 (HPRE_DIV_2) / 4 (PPRE2_DIV_4) / 8 (ADCPRE_DIV_8)
+  // 72MHz / 1 (AHB) / 8 (APB2) / 8 (ADC)
   // = 1.125MHz
   // Total conversion time = Sampling time + 12.5 cycles
   // So, if we pick a sampling time of 55.5, total is 68.
   // 1.125MHz / 68 = 16.5KHz.
   // We need to set the sampling time in the ADC registers. This is done
   // in the ADC initialization routine below.
-  RCC->CFGR = RCC_CFGR_PLLSRC_HSE | RCC_CFGR_PLLMUL_9 | RCC_CFGR_SW_PLL |
-              RCC_CFGR_PPRE2_DIV_4 | RCC_CFGR_ADCPRE_DIV_8 |
-              RCC_CFGR_HPRE_DIV_2;
+  config.apb2_divider = 8;
+  config.adc_divider = 8;
+  ClockInit(&config);
 
   RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
 
@@ -81,6 +75,117 @@ static inline void RccInitForAdc(void) {
   RCC->APB2ENR |= RCC_APB2ENR_USART1EN;
 }
 
+static inline void DmaInit() {
+  EnableNvic(DMA1_Channel1_IRQn);
+  RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+  volatile uint32_t read_value = RCC->AHBENR;
+}
+
+static inline void AdcDmaOn(void* dma_buffer, int dma_buffer_count) {
+  DMA1->CPAR1 = (uint32_t)(&ADC1->DR);
+  DMA1->CMAR1 = (uint32_t)(dma_buffer);
+  DMA1->CNDTR1 = dma_buffer_count;
+  DMA1->CCR1 = DMA_CCR_TCIE | DMA_CCR_HTIE | DMA_CCR_TEIE |
+               DMA_CCR_DIR_FROM_PERIPHERAL | DMA_CCR_CIRC | DMA_CCR_MINC |
+               DMA_CCR_PSIZE_16 | DMA_CCR_MSIZE_16 | DMA_CCR_PL_LOW;
+  DMA1->CCR1 |= DMA_CCR_EN;
+}
+
+// Starts circular DMA from the ADC without any interrupts, for use with a
+// DmaRingReader that polls the DMA position instead.
+static inline void AdcDmaOnPolled(void* dma_buffer, int dma_buffer_count) {
+  DMA1->CPAR1 = (uint32_t)(&ADC1->DR);
+  DMA1->CMAR1 = (uint32_t)(dma_buffer);
+  DMA1->CNDTR1 = dma_buffer_count;
+  DMA1->CCR1 = DMA_CCR_DIR_FROM_PERIPHERAL | DMA_CCR_CIRC | DMA_CCR_MINC |
+               DMA_CCR_PSIZE_16 | DMA_CCR_MSIZE_16 | DMA_CCR_PL_LOW;
+  DMA1->CCR1 |= DMA_CCR_EN;
+}
+
+// The longest sequence of conversions the ADC can be programmed to run.
+#define ADC_MAX_SEQUENCE_LENGTH (16)
+
+// One entry in a scan sequence. The channel is 0 to 17, where 0-7 are pins
+// A0-A7, 8 and 9 are B0 and B1, 10-15 are C0-C5, and the last two are the
+// internal temperature sensor and voltage reference. The sample time is one
+// of the ADC_SAMPLE_TIME_* values.
+typedef struct {
+  int channel;
+  int sample_time;
+} AdcChannelConfig;
+
+// Sets how long the ADC samples a channel for before converting it.
+static inline void AdcSetSampleTime(ADC_t* adc, int channel, int sample_time) {
+  if (channel < 10) {
+    const int shift = channel * 3;
+    adc->SMPR2 = (adc->SMPR2 & ~(0x7 << shift)) | (sample_time << shift);
+  } else {
+    const int shift = (channel - 10) * 3;
+    adc->SMPR1 = (adc->SMPR1 & ~(0x7 << shift)) | (sample_time << shift);
+  }
+}
+
+// Programs the order of channels that the ADC converts in scan mode, along
+// with their sample times. The first six entries go in SQR3, the next six in
+// SQR2, and the last four in SQR1, alongside the sequence length.
+static inline void AdcSetSequence(ADC_t* adc, const AdcChannelConfig* channels,
+                                  int channel_count) {
+  uint32_t sqr1 = (channel_count - 1) << ADC_SQR1_L_SHIFT;
+  uint32_t sqr2 = 0;
+  uint32_t sqr3 = 0;
+  for (int i = 0; i < channel_count; ++i) {
+    const uint32_t channel = channels[i].channel;
+    if (i < 6) {
+      sqr3 |= channel << (i * 5);
+    } else if (i < 12) {
+      sqr2 |= channel << ((i - 6) * 5);
+    } else {
+      sqr1 |= channel << ((i - 12) * 5);
+    }
+    AdcSetSampleTime(adc, channel, channels[i].sample_time);
+  }
+  adc->SQR1 = sqr1;
+  adc->SQR2 = sqr2;
+  adc->SQR3 = sqr3;
+}
+
+// Switches the pin behind an ADC channel into analog input mode. The internal
+// channels don't have pins, so they're left alone.
+static inline void AdcChannelPinInit(int channel) {
+  if (channel < 8) {
+    SetGpioMode(GPIOA, channel, GPIO_MODE_INPUT_ANALOG);
+  } else if (channel < 10) {
+    SetGpioMode(GPIOB, channel - 8, GPIO_MODE_INPUT_ANALOG);
+  } else if (channel < 16) {
+    SetGpioMode(GPIOC, channel - 10, GPIO_MODE_INPUT_ANALOG);
+  }
+}
+
+// Returns the ADC channel that reads from a pin, or -1 if it has none.
+static inline int AdcChannelForPin(GPIO_t* gpio, int port) {
+  if ((gpio == GPIOA) && (port < 8)) {
+    return port;
+  } else if ((gpio == GPIOB) && (port < 2)) {
+    return port + 8;
+  } else if ((gpio == GPIOC) && (port < 6)) {
+    return port + 10;
+  }
+  return -1;
+}
+
+// Powers up and calibrates an ADC. This has to happen before any conversions,
+// and takes a few milliseconds.
+static inline void AdcPowerOnAndCalibrate(ADC_t* adc) {
+  adc->CR2 |= ADC_CR2_ADON | ADC_CR2_TSVREFE;
+  DelayMilliseconds(30);
+  adc->CR2 |= ADC_CR2_RSTCAL;
+  while (adc->CR2 & ADC_CR2_RSTCAL) {
+  }
+  adc->CR2 |= ADC_CR2_CAL;
+  while (adc->CR2 & ADC_CR2_CAL) {
+  }
+}
+
 // This needs to be called before the ADC can be accessed.
 static inline void AdcInit(GPIO_t* gpio, int port, int do_interrupt) {
   if (do_interrupt) {
@@ -96,33 +201,298 @@ static inline void AdcInit(GPIO_t* gpio, int port, int do_interrupt) {
   }
 
   ADC1->CR2 |= ADC_CR2_ADON | ADC_CR2_TSVREFE;
-  BusyWaitMicroseconds(30 * 1000);
+  DelayMilliseconds(30);
   ADC1->CR2 |= ADC_CR2_CAL;
   while (ADC1->CR2 & ADC_CR2_CAL) {
   }
 
-  // TODO - I'm assuming the ADC is on channel 0 here.
-  ADC1->SMPR2 = ADC_SMPR2_SMP0_55_5_CYCLES;
+  // Pins that aren't connected to the ADC fall back to channel 0.
+  int channel = AdcChannelForPin(gpio, port);
+  if (channel < 0) {
+    channel = 0;
+  }
+  AdcSetSampleTime(ADC1, channel, ADC_SAMPLE_TIME_55_5_CYCLES);
+  ADC1->SQR3 = channel;
 
   ADC1->CR2 |= ADC_CR2_ADON;
 
   SetGpioMode(gpio, port, GPIO_MODE_INPUT_ANALOG);
 }
 
-static inline void DmaInit() {
-  EnableNvic(DMA1_Channel1_IRQn);
-  RCC->AHBENR |= RCC_AHBENR_DMA1EN;
-  volatile uint32_t read_value = RCC->AHBENR;
+// Sets up ADC1 to repeatedly convert a sequence of up to 16 channels, with
+// each result written out by DMA. Call AdcScanStart() to begin.
+// The results end up interleaved in the buffer, with one value for each entry
+// in the sequence in turn, so a "frame" of channel_count values is written
+// for every pass through the sequence.
+static inline void AdcScanInit(const AdcChannelConfig* channels,
+                               int channel_count) {
+  for (int i = 0; i < channel_count; ++i) {
+    AdcChannelPinInit(channels[i].channel);
+  }
+  AdcPowerOnAndCalibrate(ADC1);
+  AdcSetSequence(ADC1, channels, channel_count);
+  ADC1->CR1 |= ADC_CR1_SCAN;
+  // Writing to CR2 while ADON is set normally starts a conversion, but not
+  // if any other bits change at the same time, as they do here.
+  ADC1->CR2 = (ADC1->CR2 & ~ADC_CR2_EXTSEL_MASK) | ADC_CR2_CONT |
+              ADC_CR2_DMA | ADC_CR2_EXTSEL_SWSTART | ADC_CR2_EXTTRIG;
 }
 
-static inline void AdcDmaOn(void* dma_buffer, int dma_buffer_count) {
+// Starts circular DMA into a buffer holding frame_count frames, and kicks off
+// the first scan. DmaInit() needs to have been called first. With an even
+// frame_count, the half-transfer interrupt always falls on a frame boundary,
+// so each half of the buffer holds whole frames.
+static inline void AdcScanStart(uint16_t* buffer, int frame_count,
+                                int channel_count) {
+  AdcDmaOn(buffer, frame_count * channel_count);
+  ADC1->CR2 |= ADC_CR2_SWSTART;
+}
+
+// Timer events that can start a pass through the regular sequence, so the
+// sample rate is set exactly by a timer rather than by how long conversions
+// take. TIM3's trigger output fires on every update, while the other two use
+// a compare channel that goes high halfway through each period.
+#define ADC_TRIGGER_TIM2_CC2 (ADC_CR2_EXTSEL_TIM2_CC2)
+#define ADC_TRIGGER_TIM3_TRGO (ADC_CR2_EXTSEL_TIM3_TRGO)
+#define ADC_TRIGGER_TIM4_CC4 (ADC_CR2_EXTSEL_TIM4_CC4)
+
+// Returns which timer drives one of the ADC_TRIGGER_* events.
+static inline int AdcTriggerTimerId(int trigger) {
+  if (trigger == ADC_TRIGGER_TIM2_CC2) {
+    return TIMERID_TIM2;
+  } else if (trigger == ADC_TRIGGER_TIM4_CC4) {
+    return TIMERID_TIM4;
+  }
+  return TIMERID_TIM3;
+}
+
+// Sets up ADC1 to convert a sequence of channels each time a timer event
+// fires, with the results written out by DMA, just like AdcScanInit() but
+// without free-running. A single-entry sequence is fine for one pin. Each
+// pass has to finish before the next trigger arrives, so the total
+// conversion time of the sequence limits the sample rate.
+static inline void AdcTriggeredInit(const AdcChannelConfig* channels,
+                                    int channel_count, int trigger) {
+  for (int i = 0; i < channel_count; ++i) {
+    AdcChannelPinInit(channels[i].channel);
+  }
+  AdcPowerOnAndCalibrate(ADC1);
+  AdcSetSequence(ADC1, channels, channel_count);
+  if (channel_count > 1) {
+    ADC1->CR1 |= ADC_CR1_SCAN;
+  }
+  ADC1->CR2 = (ADC1->CR2 & ~(ADC_CR2_EXTSEL_MASK | ADC_CR2_CONT)) |
+              ADC_CR2_DMA | trigger | ADC_CR2_EXTTRIG;
+}
+
+// Programs the timer behind a trigger to fire sample_rate times a second,
+// and starts it. The timer_clock_rate is the frequency of the clock feeding
+// the timer. Returns the rate actually achieved, which will differ from the
+// one requested if it doesn't divide the timer clock exactly. Start DMA with
+// AdcDmaOn() or AdcScanStart() before calling this, so no samples are missed.
+static inline int32_t AdcTimerTriggerStart(int trigger, int32_t sample_rate,
+                                           int32_t timer_clock_rate) {
+  const int timer_id = AdcTriggerTimerId(trigger);
+  const int32_t achieved_rate =
+      TimerInitForRate(timer_id, sample_rate, timer_clock_rate);
+  TIM_t* tim = TimerIdToStruct(timer_id);
+  const uint32_t half_period = (tim->ARR + 1) / 2;
+  if (trigger == ADC_TRIGGER_TIM2_CC2) {
+    tim->CCR2 = half_period;
+    tim->CCMR1 = TIM_CCMR_OC_PWM1 << TIM_CCMR1_OC2M_SHIFT;
+    tim->CCER = TIM_CCER_CC2E;
+  } else if (trigger == ADC_TRIGGER_TIM4_CC4) {
+    tim->CCR4 = half_period;
+    tim->CCMR2 = TIM_CCMR_OC_PWM1 << TIM_CCMR2_OC4M_SHIFT;
+    tim->CCER = TIM_CCER_CC4E;
+  } else {
+    tim->CR2 = TIM_CR2_MMS_UPDATE;
+  }
+  tim->CR1 |= TIM_CR1_CEN;
+  return achieved_rate;
+}
+
+// Stops the timer driving a trigger, which pauses sampling.
+static inline void AdcTimerTriggerStop(int trigger) {
+  TIM_t* tim = TimerIdToStruct(AdcTriggerTimerId(trigger));
+  tim->CR1 &= ~TIM_CR1_CEN;
+}
+
+// The analog watchdog compares every regular conversion of a channel against
+// a window in hardware, and raises an interrupt when a value falls outside
+// it. This lets the CPU sleep while the ADC keeps sampling, and only wake
+// when something interesting happens, like a sound louder than the
+// background.
+//
+// Sets up the watchdog on ADC1 to guard a single channel, with low and high
+// limits in raw ADC units. A value below low or above high triggers it. The
+// interrupt isn't enabled until AdcWatchdogArm() is called.
+static inline void AdcWatchdogInit(int channel, uint16_t low, uint16_t high) {
+  ADC1->LTR = low;
+  ADC1->HTR = high;
+  ADC1->CR1 = (ADC1->CR1 & ~ADC_CR1_AWDCH_MASK) | channel | ADC_CR1_AWDSGL |
+              ADC_CR1_AWDEN;
+  EnableNvic(ADC_IRQ_NUMBER);
+}
+
+// Clears any earlier trigger, and enables the watchdog interrupt. The
+// interrupt calls OnAdcInterrupt(), which should check AdcWatchdogTriggered()
+// and then call AdcWatchdogDisarm(), since the watchdog will keep firing for
+// as long as the signal stays outside the window.
+static inline void AdcWatchdogArm(void) {
+  // The status flags are cleared by writing zero, and writing one leaves them
+  // alone, so this clears just the watchdog flag without racing the others.
+  ADC1->SR = ~ADC_SR_AWD;
+  ADC1->CR1 |= ADC_CR1_AWDIE;
+}
+
+static inline void AdcWatchdogDisarm(void) {
+  ADC1->CR1 &= ~ADC_CR1_AWDIE;
+  ADC1->SR = ~ADC_SR_AWD;
+}
+
+static inline int AdcWatchdogTriggered(void) {
+  return (ADC1->SR & ADC_SR_AWD) != 0;
+}
+
+// A view of the values for one entry of a scan sequence, inside a block of
+// interleaved frames. This lets code that deals with a single signal read it
+// straight out of the DMA buffer, without copying it out first.
+typedef struct {
+  const uint16_t* first;
+  int stride;
+  int count;
+} AdcChannelView;
+
+// Returns a view of the values for the sequence entry at sequence_index,
+// within frame_count frames starting at block.
+static inline AdcChannelView AdcScanChannelView(const uint16_t* block,
+                                                int frame_count,
+                                                int channel_count,
+                                                int sequence_index) {
+  AdcChannelView view;
+  view.first = block + sequence_index;
+  view.stride = channel_count;
+  view.count = frame_count;
+  return view;
+}
+
+// Returns the value at index in a channel view.
+static inline uint16_t AdcChannelViewGet(const AdcChannelView* view,
+                                         int index) {
+  return view->first[index * view->stride];
+}
+
+// Copies the values from a channel view into a contiguous array, for code
+// that needs them that way.
+static inline void AdcChannelViewCopy(const AdcChannelView* view,
+                                      uint16_t* output) {
+  const uint16_t* current = view->first;
+  for (int i = 0; i < view->count; ++i) {
+    output[i] = *current;
+    current += view->stride;
+  }
+}
+
+// The STM32F103 has two ADCs that can be run together, with ADC1 as the
+// master. In either dual mode, ADC1's data register holds the ADC1 result in
+// its bottom 16 bits and the ADC2 result in its top 16 bits, so a single DMA
+// transfer of a 32-bit word collects both.
+//
+// In regular simultaneous mode, the two ADCs sample different channels at
+// exactly the same moment, which is useful for things like stereo
+// microphones or current and voltage pairs. Both channels need the same
+// sample time.
+//
+// In fast interleaved mode, both ADCs read the same channel, with ADC1
+// starting seven ADC clock cycles after ADC2. This doubles the sample rate of
+// a single pin to one conversion every seven ADC clocks. The sampling phase
+// has to finish inside that gap, so the sample time is always 1.5 cycles,
+// which means the source needs a low impedance to settle in time.
+#define ADC_DUAL_REGULAR_SIMULTANEOUS (ADC_CR1_DUALMOD_REGULAR_SIMULTANEOUS)
+#define ADC_DUAL_FAST_INTERLEAVED (ADC_CR1_DUALMOD_FAST_INTERLEAVED)
+
+// Sets up both ADCs to convert continuously in one of the dual modes above,
+// with results written out by DMA. For fast interleaved mode, adc2_channel
+// and sample_time are ignored, since both ADCs have to use the same channel
+// and the shortest sample time. Call AdcDualStart() to begin.
+static inline void AdcDualInit(int dual_mode, int adc1_channel,
+                               int adc2_channel, int sample_time) {
+  if (dual_mode == ADC_DUAL_FAST_INTERLEAVED) {
+    adc2_channel = adc1_channel;
+    sample_time = ADC_SAMPLE_TIME_1_5_CYCLES;
+  }
+  AdcChannelPinInit(adc1_channel);
+  AdcChannelPinInit(adc2_channel);
+  const AdcChannelConfig adc1_config = {adc1_channel, sample_time};
+  const AdcChannelConfig adc2_config = {adc2_channel, sample_time};
+
+  // ADC2 is the slave, so it's set to a software trigger, and only ever
+  // starts when ADC1 does.
+  AdcPowerOnAndCalibrate(ADC2);
+  AdcSetSequence(ADC2, &adc2_config, 1);
+  ADC2->CR2 = (ADC2->CR2 & ~ADC_CR2_EXTSEL_MASK) | ADC_CR2_CONT |
+              ADC_CR2_EXTSEL_SWSTART | ADC_CR2_EXTTRIG;
+
+  AdcPowerOnAndCalibrate(ADC1);
+  AdcSetSequence(ADC1, &adc1_config, 1);
+  ADC1->CR1 = (ADC1->CR1 & ~ADC_CR1_DUALMOD_MASK) | dual_mode;
+  ADC1->CR2 = (ADC1->CR2 & ~ADC_CR2_EXTSEL_MASK) | ADC_CR2_CONT |
+              ADC_CR2_DMA | ADC_CR2_EXTSEL_SWSTART | ADC_CR2_EXTTRIG;
+}
+
+// Starts circular DMA of packed ADC1 and ADC2 results into a buffer of
+// word_count 32-bit words, and kicks off conversions on both ADCs.
+// DmaInit() needs to have been called first.
+static inline void AdcDualStart(uint32_t* buffer, int word_count) {
   DMA1->CPAR1 = (uint32_t)(&ADC1->DR);
-  DMA1->CMAR1 = (uint32_t)(dma_buffer);
-  DMA1->CNDTR1 = dma_buffer_count;
+  DMA1->CMAR1 = (uint32_t)(buffer);
+  DMA1->CNDTR1 = word_count;
   DMA1->CCR1 = DMA_CCR_TCIE | DMA_CCR_HTIE | DMA_CCR_TEIE |
                DMA_CCR_DIR_FROM_PERIPHERAL | DMA_CCR_CIRC | DMA_CCR_MINC |
-               DMA_CCR_PSIZE_16 | DMA_CCR_MSIZE_16 | DMA_CCR_PL_LOW;
+               DMA_CCR_PSIZE_32 | DMA_CCR_MSIZE_32 | DMA_CCR_PL_HIGH;
   DMA1->CCR1 |= DMA_CCR_EN;
+  ADC1->CR2 |= ADC_CR2_SWSTART;
+}
+
+// Stops both ADCs and returns ADC1 to independent mode.
+static inline void AdcDualStop(void) {
+  ADC1->CR2 &= ~ADC_CR2_ADON;
+  ADC2->CR2 &= ~ADC_CR2_ADON;
+  ADC1->CR1 &= ~ADC_CR1_DUALMOD_MASK;
+}
+
+// Pulls the individual results out of a packed dual-mode word.
+static inline uint16_t AdcDualAdc1Value(uint32_t word) {
+  return word & 0xffff;
+}
+static inline uint16_t AdcDualAdc2Value(uint32_t word) { return word >> 16; }
+
+// Splits words captured in regular simultaneous mode into separate arrays
+// for each ADC.
+static inline void AdcDualUnpackSimultaneous(const uint32_t* words,
+                                             int word_count,
+                                             uint16_t* adc1_output,
+                                             uint16_t* adc2_output) {
+  for (int i = 0; i < word_count; ++i) {
+    const uint32_t word = words[i];
+    adc1_output[i] = AdcDualAdc1Value(word);
+    adc2_output[i] = AdcDualAdc2Value(word);
+  }
+}
+
+// Turns words captured in fast interleaved mode into a single stream of
+// samples in the order they were taken, with two samples per word. ADC2
+// converts first, so its result in the top half of each word is the earlier
+// of the pair. The output can be the same memory as the input.
+static inline void AdcDualUnpackInterleaved(const uint32_t* words,
+                                            int word_count,
+                                            uint16_t* output) {
+  for (int i = 0; i < word_count; ++i) {
+    const uint32_t word = words[i];
+    output[(i * 2) + 0] = AdcDualAdc2Value(word);
+    output[(i * 2) + 1] = AdcDualAdc1Value(word);
+  }
 }
 
 static inline void AdcOn(void) { ADC1->CR2 |= ADC_CR2_ADON; }
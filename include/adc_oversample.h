@@ -0,0 +1,96 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Oversampling and decimation, to get more than the ADC's 12 bits of
+// resolution from slowly changing signals.
+//
+// Each extra bit of resolution needs four times as many samples, so for n
+// extra bits we sum 4^n raw samples and shift the total right by n. With
+// n from 1 to 4 this gives 13 to 16 bit results, at an output rate of the
+// sample rate divided by 4^n. Use AdcOversampleInputRate() to work out what
+// to ask AdcTimerTriggerStart() for, given the output rate you want.
+//
+// This only works if there's noise of at least around one LSB on the input,
+// and it's uncorrelated with the sampling, so the extra samples actually land
+// on different codes. The Blue Pill's own supply and reference noise is
+// usually enough, but a very clean or slowly drifting signal can sit on a
+// single code and gain nothing. In that case, add dither: for example a
+// triangle or sawtooth of one or two LSBs peak-to-peak, injected through a
+// large resistor from a PWM pin and repeating exactly once per output
+// period, which averages out to zero over each sum. Avoid dither that's
+// synchronized with the sample clock at any other period, since it will
+// show up as a fixed offset rather than averaging away.
+//
+// The summing kernel reads samples as packed pairs, and adds up to 16 pairs
+// at a time in the two halves of a single register before splitting them
+// apart, so it costs roughly one load and one add for every two samples.
+// That puts a firm bound on the time spent in each DMA half-buffer
+// interrupt, proportional to the half-buffer length, whatever the settings.
+
+#ifndef INCLUDE_ADC_OVERSAMPLE_H
+#define INCLUDE_ADC_OVERSAMPLE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// The range of extra bits supported, which is enough for 16-bit results.
+#define ADC_OVERSAMPLE_MIN_EXTRA_BITS (1)
+#define ADC_OVERSAMPLE_MAX_EXTRA_BITS (4)
+
+typedef struct {
+  int extra_bits;
+  // How many raw samples are summed for each result, 4^extra_bits.
+  int samples_per_output;
+  // The running total and sample count for the result in progress, carried
+  // over between blocks so they don't need to be a multiple of
+  // samples_per_output in length.
+  uint32_t accumulator;
+  int accumulated_count;
+} AdcOversampler;
+
+// Returns the raw sample rate needed to produce output_rate results a second
+// with the given number of extra bits.
+static inline int32_t AdcOversampleInputRate(int32_t output_rate,
+                                             int extra_bits) {
+  return output_rate << (extra_bits * 2);
+}
+
+// Sets up the oversampler to produce results with 12 + extra_bits bits of
+// resolution. Values outside the supported range are clamped.
+void AdcOversamplerInit(AdcOversampler* oversampler, int extra_bits);
+
+// Clears any partially accumulated result.
+void AdcOversamplerReset(AdcOversampler* oversampler);
+
+// Returns the largest number of results a block of input_count samples can
+// produce, for sizing output buffers.
+static inline int AdcOversamplerMaxOutputCount(
+    const AdcOversampler* oversampler, int input_count) {
+  return (input_count + oversampler->samples_per_output - 1) /
+         oversampler->samples_per_output;
+}
+
+// Accumulates a block of raw 12-bit ADC samples, as written by DMA, and
+// writes out any results that are completed. The results are unsigned, with
+// 12 + extra_bits significant bits. Returns the number of results written.
+int AdcOversamplerProcess(AdcOversampler* oversampler,
+                          const uint16_t* samples, int sample_count,
+                          uint16_t* outputs);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_ADC_OVERSAMPLE_H
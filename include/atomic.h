@@ -0,0 +1,173 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Atomic operations and lock-free ring buffers, for sharing data between
+// interrupt handlers and the main loop without disabling interrupts.
+//
+// The Cortex M3 has exclusive load and store instructions (LDREX and STREX).
+// A store only succeeds if nothing else has touched the location since the
+// matching load, and the processor clears the exclusive monitor on every
+// exception entry and exit. So if an interrupt arrives in the middle of a
+// read-modify-write, the store fails and we go round again, rather than
+// losing an update. Plain aligned 32-bit loads and stores are already
+// atomic, so only read-modify-write operations need these functions.
+//
+// The ring buffers have power-of-two capacities, and use free-running 32-bit
+// head and tail counters, so the number of items is always head - tail, even
+// after the counters wrap.
+//
+// SpscRing is for one producer and one consumer, for example a DMA handler
+// passing values to the main loop. It needs no atomic operations at all,
+// since each counter only has one writer.
+//
+// MpscRing is for several producers, which may preempt each other, and a
+// single consumer. Producers claim a position with a compare-and-swap, write
+// their data into the matching slot, and then publish it. Each slot has a
+// sequence number that says whether it's free, claimed, or ready, so the
+// consumer never reads a half-written slot. The ring only manages positions
+// and sequence numbers, so the data can be any type. The sequence numbers
+// are read with a stride, so they can live inside the caller's own slot
+// structures.
+
+#ifndef INCLUDE_ATOMIC_H
+#define INCLUDE_ATOMIC_H
+
+#include <stdint.h>
+
+#include "core_stm32.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Adds delta to *value, and returns the new value.
+static inline uint32_t AtomicAdd(volatile uint32_t* value, uint32_t delta) {
+  uint32_t result;
+  do {
+    result = __LDREXW(value) + delta;
+  } while (__STREXW(result, value) != 0);
+  return result;
+}
+
+static inline uint32_t AtomicIncrement(volatile uint32_t* value) {
+  return AtomicAdd(value, 1);
+}
+
+// Replaces *value with desired if it's equal to expected, and returns
+// non-zero if it was.
+static inline int AtomicCompareAndSwap(volatile uint32_t* value,
+                                       uint32_t expected, uint32_t desired) {
+  do {
+    if (__LDREXW(value) != expected) {
+      __CLREX();
+      return 0;
+    }
+  } while (__STREXW(desired, value) != 0);
+  return 1;
+}
+
+// Stores a new value, and returns the one it replaced.
+static inline uint32_t AtomicExchange(volatile uint32_t* value,
+                                      uint32_t desired) {
+  uint32_t previous;
+  do {
+    previous = __LDREXW(value);
+  } while (__STREXW(desired, value) != 0);
+  return previous;
+}
+
+// Raises *value to candidate, if it's lower.
+static inline void AtomicMax(volatile uint32_t* value, uint32_t candidate) {
+  uint32_t current;
+  do {
+    current = __LDREXW(value);
+    if (candidate <= current) {
+      __CLREX();
+      return;
+    }
+  } while (__STREXW(candidate, value) != 0);
+}
+
+typedef struct {
+  uint32_t* values;
+  uint32_t capacity;
+  // Only written by the producer.
+  volatile uint32_t head;
+  // Only written by the consumer.
+  volatile uint32_t tail;
+} SpscRing;
+
+// Sets up a ring using values for storage. The capacity must be a power of
+// two.
+void SpscRingInit(SpscRing* ring, uint32_t* values, int capacity);
+
+// Adds a value, and returns zero if the ring was full.
+int SpscRingPush(SpscRing* ring, uint32_t value);
+
+// Removes the oldest value, and returns zero if the ring was empty.
+int SpscRingPop(SpscRing* ring, uint32_t* value);
+
+static inline uint32_t SpscRingCount(const SpscRing* ring) {
+  return ring->head - ring->tail;
+}
+
+typedef struct {
+  volatile uint32_t* sequences;
+  // The distance in bytes between one slot's sequence number and the next.
+  int sequence_stride;
+  uint32_t capacity;
+  // Shared by all the producers.
+  volatile uint32_t head;
+  // Only written by the consumer.
+  volatile uint32_t tail;
+} MpscRing;
+
+// Sets up a ring. The first sequence number is at sequences, and the rest
+// follow at intervals of sequence_stride bytes, which is sizeof(uint32_t)
+// for a plain array, or the size of the caller's slot structure. The
+// capacity must be a power of two.
+void MpscRingInit(MpscRing* ring, volatile uint32_t* sequences,
+                  int sequence_stride, int capacity);
+
+// Returns the slot index for a position.
+static inline uint32_t MpscRingSlot(const MpscRing* ring, uint32_t position) {
+  return position & (ring->capacity - 1);
+}
+
+// Claims the next position for a producer. Returns zero if the ring is full,
+// otherwise fills in position, and the caller must write its data to the
+// matching slot and then call MpscRingPublish().
+int MpscRingClaim(MpscRing* ring, uint32_t* position);
+
+// Marks a claimed slot as ready for the consumer.
+void MpscRingPublish(MpscRing* ring, uint32_t position);
+
+// Looks at the oldest position. Returns zero if it's not ready yet, which can
+// also mean it's been claimed by a producer that hasn't published yet.
+// Otherwise fills in position, and the consumer should read the slot's data
+// and then call MpscRingRelease().
+int MpscRingPeek(MpscRing* ring, uint32_t* position);
+
+// Frees the oldest slot, once the consumer has finished reading it.
+void MpscRingRelease(MpscRing* ring);
+
+// Returns roughly how many positions are claimed or ready. This can be out of
+// date as soon as it's read, so it's only useful for statistics.
+static inline uint32_t MpscRingCount(const MpscRing* ring) {
+  return ring->head - ring->tail;
+}
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_ATOMIC_H
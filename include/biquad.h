@@ -0,0 +1,95 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Cascaded biquad IIR filters, with Q15 coefficients and Q31 state.
+//
+// Each section computes:
+// y[n] = b0 * x[n] + b1 * x[n-1] + b2 * x[n-2] + a1 * y[n-1] + a2 * y[n-2]
+// Note that the feedback coefficients have their signs flipped compared to
+// most filter design tools (which use "- a1 * y[n-1]"), so you'll need to
+// negate a1 and a2 when copying designs across.
+//
+// Coefficients that are greater than 1.0 in magnitude (a1 usually is) can be
+// represented by storing them scaled down by 2^post_shift, and the
+// accumulator is shifted back up by the same amount. A post_shift of 1 gives
+// a range of -2.0 to 2.0, which is enough for any stable section.
+//
+// The products are accumulated in 64 bits, which the compiler turns into
+// SMLAL instructions, and results are saturated rather than wrapping.
+// Samples are passed between sections at Q31 precision, and only rounded to
+// Q15 at the end of the cascade.
+
+#ifndef INCLUDE_BIQUAD_H
+#define INCLUDE_BIQUAD_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// The two supported filter structures. Direct form I keeps four state values
+// per section and is the most robust against overflow in fixed point.
+// Transposed direct form II only needs two, so it uses less memory and is a
+// little faster, but its internal state can grow larger than the signal.
+enum BiquadForm {
+  BIQUAD_DIRECT_FORM_1 = 1,
+  BIQUAD_TRANSPOSED_FORM_2 = 2,
+};
+
+// Coefficients for each section are stored as {b0, b1, b2, a1, a2}.
+#define BIQUAD_COEFFICIENT_COUNT (5)
+
+// How many state values each section needs for each channel.
+#define BIQUAD_STATE_COUNT(form) ((form) == BIQUAD_DIRECT_FORM_1 ? 4 : 2)
+
+// The mid-point of the 12-bit unsigned values the ADC produces.
+#define BIQUAD_ADC_OFFSET (2048)
+
+typedef struct {
+  enum BiquadForm form;
+  // Points to section_count * BIQUAD_COEFFICIENT_COUNT Q15 values.
+  const int16_t* coefficients;
+  int section_count;
+  // Samples for multiple channels are expected to be interleaved, and every
+  // channel keeps its own independent filter state.
+  int channel_count;
+  int post_shift;
+  // Points to BIQUAD_STATE_COUNT(form) * section_count * channel_count values.
+  int32_t* state;
+} BiquadCascade;
+
+// Sets up a cascade and clears its state. The coefficients and state buffer
+// must stay valid for as long as the cascade is in use.
+void BiquadCascadeInit(BiquadCascade* cascade, enum BiquadForm form,
+                       const int16_t* coefficients, int section_count,
+                       int channel_count, int post_shift, int32_t* state);
+
+// Zeroes the state of all channels.
+void BiquadCascadeReset(BiquadCascade* cascade);
+
+// Filters frame_count frames of interleaved Q15 samples in-place.
+void BiquadCascadeProcess(BiquadCascade* cascade, int16_t* data,
+                          int frame_count);
+
+// Filters raw 12-bit ADC samples in-place, as written by DMA. The offset is
+// removed and the values scaled up to Q15 as they're read, and the filtered
+// results are written back over the input as signed Q15 values. The returned
+// pointer is the same memory, typed to match its new contents.
+int16_t* BiquadCascadeProcessAdc(BiquadCascade* cascade, uint16_t* data,
+                                 int frame_count);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_BIQUAD_H
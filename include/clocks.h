@@ -0,0 +1,100 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Clock tree configuration for the "Blue Pill" STM32 board.
+//
+// The system clock comes either from the internal 8MHz RC oscillator (HSI),
+// the board's 8MHz crystal (HSE), or the PLL multiplying one of them up. It
+// then goes through a chain of dividers:
+//
+// SYSCLK -> AHB divider -> HCLK, for the processor, memory, DMA and SysTick.
+// HCLK -> APB1 divider -> PCLK1, at most 36MHz, for TIM2-4, I2C and USART2-3.
+// HCLK -> APB2 divider -> PCLK2, for GPIO, the ADCs, TIM1, SPI1 and USART1.
+// PCLK2 -> ADC divider -> ADCCLK, at most 14MHz.
+//
+// Timers run at twice their bus clock whenever the bus divider isn't one.
+//
+// ClockInit() sets all of these together, along with the flash wait states
+// the new speed needs, and switches over safely from whatever was running
+// before. The functions that return rates read the hardware registers, so
+// they're always correct, however the clocks were set up.
+
+#ifndef INCLUDE_CLOCKS_H
+#define INCLUDE_CLOCKS_H
+
+#include <stdint.h>
+
+#include "core_stm32.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// The internal oscillator, and the crystal fitted to the Blue Pill.
+#define CLOCK_HSI_RATE (8 * 1000 * 1000)
+#define CLOCK_HSE_RATE (8 * 1000 * 1000)
+
+// The named profiles:
+// 72MHz is the fastest the chip can run, from the crystal with the PLL at
+// x9, with a 36MHz APB1, a 72MHz APB2 and a 12MHz ADC clock.
+#define CLOCK_PROFILE_72MHZ (0)
+// 48MHz is the crystal with the PLL at x6, which lets USB run at its 48MHz
+// directly, with a 24MHz APB1, a 48MHz APB2 and a 12MHz ADC clock.
+#define CLOCK_PROFILE_48MHZ (1)
+// 8MHz runs everything straight from the internal oscillator with the PLL
+// and crystal off, to save power. The ADC clock is 4MHz.
+#define CLOCK_PROFILE_HSI_8MHZ (2)
+
+typedef struct {
+  // Non-zero to use the crystal, rather than the internal oscillator.
+  int use_hse;
+  // From 2 to 16, or zero to run directly from the oscillator. The PLL is
+  // fed with half the internal oscillator's rate, or the full crystal rate.
+  int pll_multiplier;
+  // 1, 2, 4, 8, 16, 64, 128, 256 or 512.
+  int ahb_divider;
+  // 1, 2, 4, 8 or 16.
+  int apb1_divider;
+  int apb2_divider;
+  // 2, 4, 6 or 8.
+  int adc_divider;
+} ClockConfig;
+
+// Fills in the settings for one of the CLOCK_PROFILE_* values, so they can
+// be adjusted before being passed to ClockInit().
+void ClockGetProfile(int profile, ClockConfig* config);
+
+// Switches the clocks over to the given settings. Dividers that aren't
+// supported are rounded up to the next one that is. Anything that depends
+// on the clock rates, like SysTick and timer prescalers, needs to be set up
+// again afterwards.
+void ClockInit(const ClockConfig* config);
+
+// Switches to one of the named profiles.
+static inline void ClockInitProfile(int profile) {
+  ClockConfig config;
+  ClockGetProfile(profile, &config);
+  ClockInit(&config);
+}
+
+// Return the current rates, in Hz.
+uint32_t ClockGetSystemRate(void);
+uint32_t ClockGetHclkRate(void);
+uint32_t ClockGetPclk1Rate(void);
+uint32_t ClockGetPclk2Rate(void);
+uint32_t ClockGetAdcRate(void);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_CLOCKS_H
@@ -49,8 +49,56 @@ typedef enum IRQn {
   DMA1_Channel5_IRQn = 15,
   DMA1_Channel6_IRQn = 16,
   DMA1_Channel7_IRQn = 17,
+  ADC1_2_IRQn = 18,
+  USB_HP_CAN1_TX_IRQn = 19,
+  USB_LP_CAN1_RX0_IRQn = 20,
+  CAN1_RX1_IRQn = 21,
+  CAN1_SCE_IRQn = 22,
+  EXTI9_5_IRQn = 23,
+  TIM1_BRK_IRQn = 24,
+  TIM1_UP_IRQn = 25,
+  TIM1_TRG_COM_IRQn = 26,
+  TIM1_CC_IRQn = 27,
+  TIM2_IRQn = 28,
+  TIM3_IRQn = 29,
+  TIM4_IRQn = 30,
+  I2C1_EV_IRQn = 31,
+  I2C1_ER_IRQn = 32,
+  I2C2_EV_IRQn = 33,
+  I2C2_ER_IRQn = 34,
+  SPI1_IRQn = 35,
+  SPI2_IRQn = 36,
+  USART1_IRQn = 37,
+  USART2_IRQn = 38,
+  USART3_IRQn = 39,
+  EXTI15_10_IRQn = 40,
+  RTCAlarm_IRQn = 41,
+  USBWakeUp_IRQn = 42,
+  TIM8_BRK_IRQn = 43,
+  TIM8_UP_IRQn = 44,
+  TIM8_TRG_COM_IRQn = 45,
+  TIM8_CC_IRQn = 46,
+  ADC3_IRQn = 47,
+  FSMC_IRQn = 48,
+  SDIO_IRQn = 49,
+  TIM5_IRQn = 50,
+  SPI3_IRQn = 51,
+  UART4_IRQn = 52,
+  UART5_IRQn = 53,
+  TIM6_IRQn = 54,
+  TIM7_IRQn = 55,
+  DMA2_Channel1_IRQn = 56,
+  DMA2_Channel2_IRQn = 57,
+  DMA2_Channel3_IRQn = 58,
+  DMA2_Channel4_5_IRQn = 59,
 } IRQn_Type;
-#define __NVIC_PRIO_BITS (2)
+
+// How many peripheral interrupts there are, on the largest F10x parts. The
+// Blue Pill's medium-density chip only uses the first 43.
+#define IRQ_COUNT (60)
+
+// The STM32F1 implements the top four bits of each priority.
+#define __NVIC_PRIO_BITS (4)
 
 // We want to use the standard ARM SysTick implementation, so indicate there's
 // no manufacturer-supplied version.
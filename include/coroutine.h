@@ -0,0 +1,138 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Stackless coroutines, in the style of protothreads, for writing code that
+// waits on DMA transfers, ADC samples and timers as straight-line steps
+// rather than as a hand-written state machine, without the cost of a stack
+// for each one.
+//
+// A coroutine is a function that takes a Coroutine, whose only state is the
+// line number to carry on from, so each one costs two bytes. The macros
+// turn the function body into a switch on that line, so a wait returns to
+// the caller if the condition isn't met yet, and the next call jumps
+// straight back to the same place to check again:
+//
+// static int Reader(Coroutine* co) {
+//   COROUTINE_BEGIN(co);
+//   while (1) {
+//     DmaCopyStart(channel, dest, source, count, DMA_WIDTH_32,
+//                  CoroutineDmaWake, 0);
+//     COROUTINE_WAIT_DMA(co, channel);
+//     ...
+//   }
+//   COROUTINE_END(co);
+// }
+//
+// Since the function really does return, local variables don't survive a
+// wait, so anything that needs to should be kept in a struct or static.
+// Switch statements can't be used in a coroutine body around a wait, since
+// they'd clash with the one the macros build, and each wait has to be on a
+// line of its own, since the line number is its label.
+//
+// To run coroutines, call them in turn from the main loop. If everything
+// they're waiting on finishes with an interrupt, the loop can sleep between
+// passes with interrupts masked, as described for PowerSleep(). DMA
+// transfers only raise an interrupt if they're started with a callback, so
+// pass CoroutineDmaWake if there's nothing else to do on completion.
+
+#ifndef INCLUDE_COROUTINE_H
+#define INCLUDE_COROUTINE_H
+
+#include <stdint.h>
+
+#include "dma.h"
+#include "timebase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// What a coroutine function returns.
+#define COROUTINE_WAITING (0)
+#define COROUTINE_DONE (1)
+
+typedef struct {
+  // The line to resume from, or zero to start from the beginning.
+  uint16_t line;
+} Coroutine;
+
+// Timers for COROUTINE_SLEEP_US() need somewhere to keep their deadline.
+typedef uint32_t CoroutineTimer;
+
+static inline void CoroutineInit(Coroutine* co) { co->line = 0; }
+
+#define COROUTINE_BEGIN(co) \
+  switch ((co)->line) {     \
+    case 0:
+
+// Finishes the coroutine. Calling it again starts it from the beginning.
+#define COROUTINE_END(co) \
+  }                       \
+  (co)->line = 0;         \
+  return COROUTINE_DONE
+
+// Returns until cond is true.
+#define COROUTINE_WAIT_UNTIL(co, cond) \
+  do {                                 \
+    (co)->line = __LINE__;             \
+    case __LINE__:                     \
+      if (!(cond)) {                   \
+        return COROUTINE_WAITING;      \
+      }                                \
+  } while (0)
+
+// Gives everything else a turn before carrying on.
+#define COROUTINE_YIELD(co)   \
+  do {                        \
+    (co)->line = __LINE__;    \
+    return COROUTINE_WAITING; \
+    case __LINE__:;           \
+  } while (0)
+
+// Waits for a DMA transfer to finish.
+#define COROUTINE_WAIT_DMA(co, channel) \
+  COROUTINE_WAIT_UNTIL(co, !DmaIsBusy(channel))
+
+// Waits until a DMA ring reader has at least count values available.
+#define COROUTINE_WAIT_SAMPLES(co, reader, count) \
+  COROUTINE_WAIT_UNTIL(co, DmaRingReaderAvailable(reader) >= (count))
+
+// Waits for a flag to be set, usually by an interrupt handler, and then
+// clears it ready for next time.
+#define COROUTINE_WAIT_EVENT(co, flag) \
+  do {                                 \
+    COROUTINE_WAIT_UNTIL(co, (flag));  \
+    (flag) = 0;                        \
+  } while (0)
+
+// Waits for the given number of microseconds, measured by the timebase, so
+// TimebaseInit() must have been called. The timer holds the deadline, and
+// must outlive the wait. Waits must be shorter than 35 minutes.
+#define COROUTINE_SLEEP_US(co, timer, us)                   \
+  do {                                                      \
+    (timer) = TimebaseGet32() + (us);                       \
+    COROUTINE_WAIT_UNTIL(co, CoroutineTimerExpired(timer)); \
+  } while (0)
+
+static inline int CoroutineTimerExpired(CoroutineTimer timer) {
+  return (int32_t)(TimebaseGet32() - timer) >= 0;
+}
+
+// A DMA completion callback that does nothing, so that the transfer raises
+// an interrupt and wakes a sleeping main loop.
+static inline void CoroutineDmaWake(int channel, int has_error, void* arg) {}
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_COROUTINE_H
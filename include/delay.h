@@ -0,0 +1,70 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Delays timed by the DWT cycle counter, so they're accurate whatever the
+// optimization level, flash wait states, or clock setup. Delays shorter
+// than about a minute at 72MHz are accurate to within a few cycles, plus
+// the time taken by any interrupts that arrive near the end. The cycle
+// counter is turned on by the first call if it isn't already running.
+//
+// These all keep the processor busy. For long waits where that isn't
+// needed, DelaySleepMilliseconds() sleeps between SysTick interrupts
+// instead, which uses much less power.
+
+#ifndef INCLUDE_DELAY_H
+#define INCLUDE_DELAY_H
+
+#include <stdint.h>
+
+#include "core_stm32.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Turns the cycle counter on, if something else hasn't already.
+static inline void DelayEnableCycleCounter(void) {
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+}
+
+// Spins until the given number of processor cycles have passed since the
+// cycle counter read start. Waits must be less than 2^32 cycles.
+static inline void DelayUntilCycles(uint32_t start, uint32_t cycles) {
+  while ((DWT->CYCCNT - start) < cycles) {
+  }
+}
+
+// Spins for the given number of processor cycles.
+static inline void DelayCycles(uint32_t cycles) {
+  DelayEnableCycleCounter();
+  DelayUntilCycles(DWT->CYCCNT, cycles);
+}
+
+// Spins for the given time, at the current HCLK rate.
+void DelayMicroseconds(uint32_t us);
+void DelayMilliseconds(uint32_t ms);
+
+// Waits for the given time, sleeping with WFI until the last SysTick period
+// and then spinning for the rest, so it's as accurate as the busy delays.
+// If SysTick isn't already running with its interrupt on, it's started at
+// 1kHz for the wait and stopped again afterwards, which increments
+// g_tick_count along the way. Other interrupts are handled as normal.
+void DelaySleepMilliseconds(uint32_t ms);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_DELAY_H
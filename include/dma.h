@@ -0,0 +1,177 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// DMA utility functions.
+
+#ifndef INCLUDE_DMA_H
+#define INCLUDE_DMA_H
+
+#include "core_stm32.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// The Blue Pill's STM32F103 only has DMA1, with channels 1 to 7.
+#define DMA_CHANNEL_COUNT (7)
+
+// Converts from a channel number, starting at 1 as in the reference manual,
+// to its registers.
+static inline DMA_Channel_t* DmaChannelToStruct(DMA_t* dma, int channel) {
+  return (DMA_Channel_t*)(&dma->CCR1 + ((channel - 1) * 5));
+}
+
+// Converts one of the channel 1 DMA_ISR_* or DMA_IFCR_* flags into the
+// equivalent for another channel.
+static inline uint32_t DmaChannelFlag(int channel, uint32_t channel1_flag) {
+  return channel1_flag << ((channel - 1) * 4);
+}
+
+// Reads newly arrived values from a circular DMA buffer without any
+// interrupts, by looking at how far the channel has got through its transfer
+// count. This means a consumer can pick up samples as soon as they land, in
+// chunks of any size, rather than waiting for a half-buffer to fill.
+//
+// The reader keeps running totals of values written and read, using how far
+// the DMA position has moved since it last looked. The position alone can't
+// tell whether the DMA has also been all the way round in the meantime, so
+// the reader must be updated, by any of the calls below, at least once every
+// half buffer. The reader also watches the channel's half transfer and
+// transfer complete flags, so the channel's interrupts for them mustn't be in
+// use. A flag that's been set without the position passing its boundary
+// shows there's been an extra lap, which catches many longer gaps, but not
+// all of them.
+//
+// If the reader falls a whole buffer behind, the oldest unread values have
+// already been overwritten, so it skips forward to the newest data and
+// counts an overrun. Overruns are only counted reliably when the reader is
+// updated often enough, so after anything that might block for longer, like
+// logging, call DmaRingReaderSkip() to start again from the newest data.
+typedef struct {
+  DMA_Channel_t* channel;
+  uint32_t half_transfer_flag;
+  uint32_t transfer_complete_flag;
+  const uint16_t* buffer;
+  int buffer_count;
+  // Where the DMA was writing at the last update.
+  int write_index;
+  int read_index;
+  // Running totals, used to tell how far behind the reader is.
+  uint32_t written_count;
+  uint32_t read_count;
+  // The flags for boundaries the position passed before we saw the flags
+  // themselves, so that their later appearance isn't mistaken for a lap.
+  uint32_t pending_flags;
+  uint32_t overrun_count;
+} DmaRingReader;
+
+// Sets up a reader for a DMA1 channel that's already running in circular
+// mode into buffer, which holds buffer_count values. The count must be even,
+// so the half transfer flag falls exactly halfway. Reading starts from the
+// current DMA position, so nothing written earlier is returned.
+void DmaRingReaderInit(DmaRingReader* reader, int channel,
+                       const uint16_t* buffer, int buffer_count);
+
+// Throws away any unread values and starts reading again from the current
+// DMA position, without counting an overrun. Use this after the reader has
+// gone too long without an update to trust its count of what was written.
+void DmaRingReaderSkip(DmaRingReader* reader);
+
+// Returns how many values are waiting to be read. This catches up with the
+// DMA position, and handles any overrun, so it's worth calling before each
+// batch of reads.
+int DmaRingReaderAvailable(DmaRingReader* reader);
+
+// Gives direct access to the waiting values, without copying. Sets data to
+// the oldest unread value, and returns how many follow it contiguously in
+// the buffer. When the unread values wrap around the end of the buffer, this
+// is less than DmaRingReaderAvailable(), and another peek after consuming
+// them returns the rest. Values must be used before the DMA comes back round
+// to overwrite them.
+int DmaRingReaderPeek(DmaRingReader* reader, const uint16_t** data);
+
+// Marks values returned by DmaRingReaderPeek() as read.
+void DmaRingReaderConsume(DmaRingReader* reader, int count);
+
+// Copies up to max_count waiting values into output, and returns how many
+// were copied.
+int DmaRingReaderRead(DmaRingReader* reader, uint16_t* output,
+                      int max_count);
+
+// Memory-to-memory transfers, for copying and filling buffers in the
+// background while the CPU gets on with something else.
+//
+// Channel 1 is left for the ADC, so these use channels 2 to 7, which have to
+// be claimed first so that different parts of a program don't trip over each
+// other. A transfer can either call back from the channel's interrupt when
+// it's done, or be polled with DmaIsBusy() or DmaWait(). Each transfer moves
+// at most DMA_MAX_TRANSFER_COUNT elements.
+//
+// DMA and the CPU share the bus matrix, so a copy running alongside code
+// that's heavy on loads and stores will slow both down a little, but code
+// that works mostly in registers, like the inner loops of a matrix multiply,
+// barely notices. Mem-to-mem transfers run at low priority, so they give
+// way to the ADC's DMA.
+
+#define DMA_MAX_TRANSFER_COUNT (0xffff)
+
+// The size of each element, in bytes.
+#define DMA_WIDTH_8 (1)
+#define DMA_WIDTH_16 (2)
+#define DMA_WIDTH_32 (4)
+
+// The first channel that's available for memory-to-memory transfers.
+#define DMA_FIRST_MEM2MEM_CHANNEL (2)
+
+// Called from the channel's interrupt handler when a transfer finishes.
+// has_error is non-zero if the transfer failed, usually because of a bad
+// address.
+typedef void (*OnDmaCompleteCallback)(int channel, int has_error, void* arg);
+
+// Claims a free channel for memory-to-memory use, and returns its number, or
+// zero if they're all taken. The channel's interrupt handler is replaced with
+// one that finishes transfers. This is safe to call from interrupt handlers.
+int DmaClaimChannel(void);
+
+// Returns a channel to the pool. It mustn't be busy.
+void DmaReleaseChannel(int channel);
+
+// Starts copying count elements of the given width from source to dest. The
+// addresses must be aligned to the width. If callback is non-zero, it's
+// called from the channel's interrupt when the copy is done. Returns zero if
+// the channel is busy or the count is too large.
+int DmaCopyStart(int channel, void* dest, const void* source, int count,
+                 int width, OnDmaCompleteCallback callback, void* arg);
+
+// Starts writing value to count elements of the given width at dest, like
+// memset() but for any width. The value is copied, so it doesn't need to
+// stay around. Otherwise this behaves like DmaCopyStart().
+int DmaFillStart(int channel, void* dest, uint32_t value, int count,
+                 int width, OnDmaCompleteCallback callback, void* arg);
+
+// Returns non-zero while a transfer is still running. For transfers without a
+// callback, this also finishes them off once they're done.
+int DmaIsBusy(int channel);
+
+// Waits until a transfer has finished, and returns non-zero if it failed.
+int DmaWait(int channel);
+
+// Finishes a transfer and calls its callback. DmaClaimChannel() installs a
+// handler for the channel that calls this, using the SRAM vector table from
+// vector_table.h.
+void DmaHandleInterrupt(int channel);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_DMA_H
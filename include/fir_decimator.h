@@ -0,0 +1,90 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Polyphase FIR decimation filter, for reducing the sample rate of an ADC
+// stream by an integer factor while removing the frequencies that would
+// otherwise alias.
+//
+// A decimator with factor M only keeps every M-th output of the filter, so
+// instead of filtering every input sample and throwing most of the results
+// away, only the kept outputs are ever calculated. This is equivalent to
+// running each of the M polyphase sub-filters at the low output rate, and is
+// M times cheaper than filtering followed by discarding.
+//
+// The filter keeps the last (tap_count - 1) input samples in a small history
+// buffer between calls, so it can be run directly on each DMA half-buffer as
+// it arrives, without copying the samples anywhere first. Blocks don't need
+// to be a multiple of the decimation factor in length, the position of the
+// next output is carried over between calls.
+
+#ifndef INCLUDE_FIR_DECIMATOR_H
+#define INCLUDE_FIR_DECIMATOR_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// The mid-point of the 12-bit unsigned values the ADC produces.
+#define FIR_DECIMATOR_ADC_OFFSET (2048)
+
+typedef struct {
+  // Filter coefficients in Q15 format, in the usual order with taps[0]
+  // applied to the newest sample. The sum of their absolute values should be
+  // below 2.0 (true for any ordinary low-pass design) so the 32-bit
+  // accumulator can't overflow.
+  const int16_t* taps;
+  int tap_count;
+  // How many input samples are consumed for each output sample.
+  int factor;
+  // The last (tap_count - 1) input samples seen, oldest first, in Q15.
+  int16_t* history;
+  // How many samples into the next block the next output falls.
+  int phase;
+  // Sum of all the taps, used to remove the ADC's offset cheaply.
+  int32_t tap_sum;
+} FirDecimator;
+
+// Sets up the filter state. The history buffer must hold at least
+// (tap_count - 1) values, and the taps and history must stay valid for as
+// long as the decimator is in use.
+void FirDecimatorInit(FirDecimator* decimator, const int16_t* taps,
+                      int tap_count, int factor, int16_t* history);
+
+// Clears the history, as if the filter had only ever seen silence.
+void FirDecimatorReset(FirDecimator* decimator);
+
+// Returns the largest number of outputs a block of input_count samples can
+// produce, for sizing output buffers.
+static inline int FirDecimatorMaxOutputCount(const FirDecimator* decimator,
+                                             int input_count) {
+  return (input_count + decimator->factor - 1) / decimator->factor;
+}
+
+// Filters and decimates a block of signed Q15 samples, writing the results to
+// output. Returns the number of output values written.
+int FirDecimatorProcess(FirDecimator* decimator, const int16_t* input,
+                        int input_count, int16_t* output);
+
+// Filters and decimates a block of raw 12-bit ADC samples, as written by DMA.
+// The results are signed Q15 values, centered around zero. Removing the ADC
+// offset and scaling is folded into the output step, so this costs no more
+// per tap than FirDecimatorProcess().
+int FirDecimatorProcessAdc(FirDecimator* decimator, const uint16_t* input,
+                           int input_count, int16_t* output);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_FIR_DECIMATOR_H
@@ -0,0 +1,74 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// A bank of Goertzel filters, for detecting a handful of known tones in a
+// block of ADC samples much more cheaply than running a full FFT.
+//
+// Each tone costs one multiply-accumulate per sample, so the total cost
+// scales with the number of tones being listened for. After each block, the
+// energy at every tone's frequency is compared against the total energy of
+// the block, and tones whose share is above a threshold are reported as
+// detected.
+
+#ifndef INCLUDE_GOERTZEL_H
+#define INCLUDE_GOERTZEL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#define GOERTZEL_MAX_TONES (8)
+
+// Fixed-point representation of 1.0 for tone levels and thresholds.
+#define GOERTZEL_LEVEL_ONE (1 << 15)
+
+// Called once for every tone that's detected in a block, with the index of
+// the tone in the frequency list passed to GoertzelBankInit(), and its level.
+typedef void (*OnGoertzelToneCallback)(int tone_index, int32_t level);
+
+typedef struct {
+  int tone_count;
+  // 2 * cos(2 * pi * frequency / sample_rate) for each tone, in Q14.
+  int32_t coefficients[GOERTZEL_MAX_TONES];
+  // For the most recent block, the fraction of its energy that was at each
+  // tone's frequency, where GOERTZEL_LEVEL_ONE means all of it. A pure
+  // sine wave that's exactly on a tone's frequency shows up as roughly 1.0.
+  int32_t levels[GOERTZEL_MAX_TONES];
+  // The level a tone has to reach to count as detected.
+  int32_t threshold;
+  // Estimate of the ADC's DC level, updated with the mean of every block.
+  int32_t dc_offset;
+  OnGoertzelToneCallback callback;
+} GoertzelBank;
+
+// Sets up detectors for tone_count frequencies (in Hz), for a signal sampled
+// at sample_rate. The callback can be null if you only want the return value
+// of GoertzelBankProcessAdc().
+void GoertzelBankInit(GoertzelBank* bank, const int32_t* frequencies,
+                      int tone_count, int32_t sample_rate, int32_t threshold,
+                      OnGoertzelToneCallback callback);
+
+// Analyzes a block of raw 12-bit ADC samples, such as a DMA half-buffer.
+// Updates the levels for every tone, calls the callback for each one that was
+// detected, and returns a bit mask with bit N set if tone N was detected.
+// The frequency resolution is roughly sample_rate / count, so blocks need to
+// be long enough to separate the tones you're interested in.
+uint32_t GoertzelBankProcessAdc(GoertzelBank* bank, const uint16_t* samples,
+                                int count);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_GOERTZEL_H
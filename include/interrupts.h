@@ -0,0 +1,139 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Interrupt priorities and nesting.
+//
+// Every interrupt starts at priority 0, so none can preempt another, and a
+// slow handler delays everything else that becomes pending while it runs.
+// Giving the latency-critical handlers, like the one that captures samples,
+// a more urgent priority than the ones doing longer work fixes that.
+//
+// The STM32F1 has four bits of priority for each interrupt, and lower
+// numbers are more urgent. The bits are split between a preempt priority,
+// which decides whether one handler can interrupt another, and a sub
+// priority, which only decides which of several pending interrupts with the
+// same preempt priority goes first. InterruptSetGrouping() chooses the
+// split, and should be called before any priorities are set, since it
+// changes how the existing ones are read. The reset default is all four bits
+// for preemption.
+//
+// For critical sections, __disable_irq() masks everything. Masking with
+// BASEPRI instead only holds off interrupts at or below a given preempt
+// priority, so more urgent ones still get through, as long as they don't
+// touch whatever the critical section is protecting.
+
+#ifndef INCLUDE_INTERRUPTS_H
+#define INCLUDE_INTERRUPTS_H
+
+#include <stdint.h>
+
+#include "core_stm32.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#define INTERRUPT_PRIORITY_BITS (__NVIC_PRIO_BITS)
+#define INTERRUPT_PRIORITY_HIGHEST (0)
+
+// Uses preempt_bits of the priority for preemption, and the rest for sub
+// priority, from zero to four.
+static inline void InterruptSetGrouping(int preempt_bits) {
+  // PRIGROUP gives the position of the highest sub priority bit, counting
+  // from the bottom of the eight-bit field, of which we have the top four.
+  NVIC_SetPriorityGrouping(7 - preempt_bits);
+}
+
+// Returns the number of bits used for preemption.
+static inline int InterruptGetPreemptBits(void) {
+  int preempt_bits = 7 - (int)(NVIC_GetPriorityGrouping());
+  if (preempt_bits > INTERRUPT_PRIORITY_BITS) {
+    preempt_bits = INTERRUPT_PRIORITY_BITS;
+  }
+  return preempt_bits;
+}
+
+// The least urgent preempt priority, with the current grouping.
+static inline int InterruptLowestPreemptPriority(void) {
+  return (1 << InterruptGetPreemptBits()) - 1;
+}
+
+// Sets the priority of an interrupt, or of a configurable system exception
+// like PendSV or SysTick if irq is negative.
+static inline void InterruptSetPriority(IRQn_Type irq, int preempt,
+                                        int sub) {
+  NVIC_SetPriority(irq,
+                   NVIC_EncodePriority(NVIC_GetPriorityGrouping(), preempt,
+                                       sub));
+}
+
+static inline void InterruptGetPriority(IRQn_Type irq, int* preempt,
+                                        int* sub) {
+  uint32_t preempt_value;
+  uint32_t sub_value;
+  NVIC_DecodePriority(NVIC_GetPriority(irq), NVIC_GetPriorityGrouping(),
+                      &preempt_value, &sub_value);
+  *preempt = preempt_value;
+  *sub = sub_value;
+}
+
+// These only work for peripheral interrupts, not system exceptions.
+static inline void InterruptEnable(IRQn_Type irq) { NVIC_EnableIRQ(irq); }
+static inline void InterruptDisable(IRQn_Type irq) { NVIC_DisableIRQ(irq); }
+static inline int InterruptIsEnabled(IRQn_Type irq) {
+  return NVIC_GetEnableIRQ(irq);
+}
+static inline int InterruptIsPending(IRQn_Type irq) {
+  return NVIC_GetPendingIRQ(irq);
+}
+static inline void InterruptSetPending(IRQn_Type irq) {
+  NVIC_SetPendingIRQ(irq);
+}
+static inline void InterruptClearPending(IRQn_Type irq) {
+  NVIC_ClearPendingIRQ(irq);
+}
+// Returns non-zero if the interrupt's handler is running, including when
+// it's been preempted by a more urgent one.
+static inline int InterruptIsActive(IRQn_Type irq) {
+  return NVIC_GetActive(irq);
+}
+
+// Returns non-zero if we're in any exception handler.
+static inline int InterruptIsInHandler(void) { return __get_IPSR() != 0; }
+
+// Returns the interrupt whose handler is running, which is negative for
+// system exceptions. This is only meaningful in a handler.
+static inline IRQn_Type InterruptCurrent(void) {
+  return (IRQn_Type)((int)(__get_IPSR()) - 16);
+}
+
+// Masks every interrupt whose preempt priority is the given one or less
+// urgent, and returns the previous mask to pass to InterruptRestoreMask().
+// This never lowers an existing mask, so sections can nest. Priority 0 can't
+// be masked this way, so use __disable_irq() for that.
+static inline uint32_t InterruptMaskFrom(int preempt) {
+  const uint32_t previous = __get_BASEPRI();
+  const int shift = 8 - INTERRUPT_PRIORITY_BITS;
+  const int sub_bits = INTERRUPT_PRIORITY_BITS - InterruptGetPreemptBits();
+  __set_BASEPRI_MAX((preempt << (sub_bits + shift)) & 0xff);
+  return previous;
+}
+
+static inline void InterruptRestoreMask(uint32_t previous) {
+  __set_BASEPRI(previous);
+}
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_INTERRUPTS_H
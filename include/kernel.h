@@ -0,0 +1,166 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// A small preemptive kernel, for programs where something time-critical,
+// like servicing a sensor, has to be able to interrupt a long computation,
+// like running inference, without the computation having to be broken up by
+// hand.
+//
+// Each task has its own stack and a fixed priority from 0, the most urgent,
+// to KERNEL_PRIORITY_COUNT - 2, and each priority can only have one task.
+// The last priority belongs to the idle task, which sleeps with WFI. The
+// ready tasks are kept as a bitmap with the most urgent priority in the top
+// bit, so the next task to run is found with a single CLZ instruction,
+// however many tasks there are.
+//
+// The most urgent ready task always runs. When that changes, because a task
+// blocked or an interrupt handler woke another one, PendSV is triggered at
+// the lowest exception priority, and once every other handler has finished
+// it saves r4-r11 on the old task's stack, which is on the process stack
+// pointer, and restores the new task's. The hardware saves and restores
+// everything else as part of the exception, and handlers keep running on the
+// main stack.
+//
+// The kernel needs PendSV, but programs that don't use it may want PendSV
+// for something else, so it's up to the program to route it here, with:
+//
+// __attribute__((naked)) void OnPendSV() { __asm("b KernelPendSV"); }
+//
+// It also takes over SysTick, through g_tick_callback, for KernelSleep().
+//
+// Semaphores can be given from interrupt handlers, which is the usual way
+// to wake a task when hardware needs attention. Mutexes are for sharing
+// things between tasks. They use priority inheritance, so a task holding a
+// mutex that a more urgent task is waiting for runs at the waiting task's
+// priority until it unlocks it, and tasks in between can't hold the urgent
+// one up. Inheritance only goes one level, so it doesn't follow a chain of
+// owners that are themselves waiting for other mutexes.
+//
+// None of the blocking functions can be called from interrupt handlers, or
+// with interrupts disabled.
+
+#ifndef INCLUDE_KERNEL_H
+#define INCLUDE_KERNEL_H
+
+#include <stdint.h>
+
+#include "core_stm32.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#define KERNEL_PRIORITY_COUNT (32)
+#define KERNEL_IDLE_PRIORITY (KERNEL_PRIORITY_COUNT - 1)
+
+// The smallest stack a task can have, in words. This covers the registers
+// saved on a context switch and by an interrupt, but not whatever the task
+// itself needs.
+#define KERNEL_MIN_STACK_WORDS (32)
+
+typedef void (*KernelTaskFunction)(void* arg);
+
+struct KernelMutex;
+
+typedef struct {
+  // The saved stack pointer. This has to come first, since the context
+  // switch finds it at the start of the struct.
+  uint32_t* stack_pointer;
+  int base_priority;
+  // The base priority, or the priority it's inherited from a waiter.
+  int priority;
+  int state;
+  // For blocked tasks, the bitmap of waiters it's in.
+  volatile uint32_t* wait_list;
+  uint32_t wake_tick;
+  // Mutexes the task holds, so its priority can be worked out on unlock.
+  struct KernelMutex* held_mutexes;
+  uint32_t* stack;
+  int stack_words;
+} KernelTask;
+
+typedef struct {
+  volatile int32_t count;
+  // A bit for each waiting task, by base priority.
+  volatile uint32_t waiting;
+} KernelSemaphore;
+
+typedef struct KernelMutex {
+  KernelTask* owner;
+  volatile uint32_t waiting;
+  struct KernelMutex* next_held;
+} KernelMutex;
+
+// Sets up the kernel and its idle task. This must be called first.
+void KernelInit(void);
+
+// Adds a task that will start running function with arg once the kernel has
+// started, or straight away if it already has and it's the most urgent. The
+// stack is an array of stack_words words. Returns zero if the priority is
+// already taken or out of range, or the stack is too small. Tasks can
+// return when they're done.
+int KernelCreateTask(KernelTask* task, int priority,
+                     KernelTaskFunction function, void* arg, uint32_t* stack,
+                     int stack_words);
+
+// Starts SysTick at tick_rate times a second, and starts running tasks. This
+// never returns, and the main stack is only used for interrupts from then
+// on.
+void KernelStart(uint32_t tick_rate);
+
+// Returns the task that's running.
+KernelTask* KernelCurrentTask(void);
+
+// Returns how many SysTick periods have passed since KernelStart().
+uint32_t KernelGetTicks(void);
+
+// Blocks the current task for the given number of ticks.
+void KernelSleep(uint32_t ticks);
+
+// Returns how many words of a task's stack have ever been used, by looking
+// for the fill pattern it was created with.
+int KernelTaskStackUsed(const KernelTask* task);
+
+void KernelSemaphoreInit(KernelSemaphore* semaphore, int32_t count);
+
+// Decrements the count, waiting for it to be non-zero first.
+void KernelSemaphoreTake(KernelSemaphore* semaphore);
+
+// Decrements the count if it's non-zero, and returns whether it was. This
+// is safe to call from interrupt handlers.
+int KernelSemaphoreTryTake(KernelSemaphore* semaphore);
+
+// Wakes the most urgent waiting task, or increments the count if there are
+// none. This is safe to call from interrupt handlers, and if it wakes a task
+// that's more urgent than the one that was interrupted, the switch happens
+// as soon as the handlers finish.
+void KernelSemaphoreGive(KernelSemaphore* semaphore);
+
+void KernelMutexInit(KernelMutex* mutex);
+
+// Takes ownership of the mutex, waiting for the owner to unlock it if it's
+// held. Mutexes aren't recursive, so a task mustn't lock one it holds.
+void KernelMutexLock(KernelMutex* mutex);
+
+// Hands the mutex to the most urgent waiter, if there is one. Only the
+// owner can unlock it.
+void KernelMutexUnlock(KernelMutex* mutex);
+
+// The context switch, which needs to be called from OnPendSV() as described
+// above.
+void KernelPendSV(void);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_KERNEL_H
@@ -0,0 +1,114 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Access to the Cortex-M3's DWT performance counters, to see where the
+// cycles in a piece of code go, not just how many there were.
+//
+// Alongside the 32-bit cycle counter, the DWT unit has five 8-bit counters:
+// - CPI counts the extra cycles taken by instructions that need more than
+//   one, apart from loads and stores, including stalls fetching code from
+//   flash.
+// - Exception counts cycles spent entering and leaving interrupt handlers.
+// - Sleep counts cycles spent asleep.
+// - LSU counts the extra cycles taken by loads and stores.
+// - Fold counts instructions that took no cycles at all, like IT.
+//
+// The number of instructions executed can then be calculated as:
+// cycles - CPI - exception - sleep - LSU + fold.
+//
+// The 8-bit counters wrap every 256 events, so for anything longer than a
+// few hundred cycles call PerfCountersUpdate() regularly to fold them into
+// the session totals, often enough that no counter can see 256 events in
+// between. Any more are silently lost, so that usually means updating from
+// an inner loop, not once per run of a benchmark.
+// The cycle counter wraps after a minute at 72MHz, and is handled the same
+// way.
+
+#ifndef INCLUDE_PERF_COUNTERS_H
+#define INCLUDE_PERF_COUNTERS_H
+
+#include <stdint.h>
+
+#include "core_stm32.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Flags for choosing which counters a session uses.
+#define PERF_COUNTER_CYCLES (1 << 0)
+#define PERF_COUNTER_CPI (1 << 1)
+#define PERF_COUNTER_EXCEPTION (1 << 2)
+#define PERF_COUNTER_SLEEP (1 << 3)
+#define PERF_COUNTER_LSU (1 << 4)
+#define PERF_COUNTER_FOLD (1 << 5)
+#define PERF_COUNTER_ALL (0x3f)
+
+typedef struct {
+  uint64_t cycles;
+  uint32_t cpi_cycles;
+  uint32_t exception_cycles;
+  uint32_t sleep_cycles;
+  uint32_t lsu_cycles;
+  uint32_t folded_count;
+} PerfCounts;
+
+typedef struct {
+  uint32_t counters;
+  // The raw counter values at the last update.
+  uint32_t last_cycles;
+  uint8_t last_cpi;
+  uint8_t last_exception;
+  uint8_t last_sleep;
+  uint8_t last_lsu;
+  uint8_t last_fold;
+  PerfCounts totals;
+} PerfCounterSession;
+
+// Turns on the trace unit, which the DWT counters need. Returns zero if this
+// chip doesn't have a cycle counter.
+int PerfCountersInit(void);
+
+// Starts a session, enabling the counters given by the PERF_COUNTER_* flags.
+// Counters that weren't asked for stay at zero in the results.
+void PerfCountersStart(PerfCounterSession* session, uint32_t counters);
+
+// Adds the changes in the counters since the last update to the totals.
+void PerfCountersUpdate(PerfCounterSession* session);
+
+// Ends a session, and fills in the totals.
+void PerfCountersStop(PerfCounterSession* session, PerfCounts* counts);
+
+// Returns the number of instructions executed. This is only meaningful if
+// all the counters were enabled.
+static inline uint64_t PerfCountsInstructions(const PerfCounts* counts) {
+  return counts->cycles - counts->cpi_cycles - counts->exception_cycles -
+         counts->sleep_cycles - counts->lsu_cycles + counts->folded_count;
+}
+
+// Returns cycles per instruction, in hundredths.
+static inline uint32_t PerfCountsCpiHundredths(const PerfCounts* counts) {
+  const uint64_t instructions = PerfCountsInstructions(counts);
+  if (instructions == 0) {
+    return 0;
+  }
+  return (uint32_t)((counts->cycles * 100) / instructions);
+}
+
+// Writes the counts to the debug log, after the label.
+void PerfCountsLog(char* label, const PerfCounts* counts);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_PERF_COUNTERS_H
@@ -0,0 +1,142 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Low-power modes, for programs that spend most of their time waiting.
+//
+// Sleep stops the processor clock until an interrupt (WFI) or an event (WFE)
+// arrives, but leaves everything else running, so timers, DMA and the ADC
+// carry on and can wake it. Waking takes a couple of cycles.
+//
+// Stop turns off the PLL, the crystal and every clock apart from the
+// low-speed ones, with the regulator in low-power mode, which brings the
+// current down to tens of microamps. Only the EXTI lines can wake it, from
+// pins, the RTC alarm, or USB. The chip always wakes running from the 8MHz
+// internal oscillator, so PowerStop() puts the clocks back the way they were
+// before returning. SysTick, timers and the ADC are all frozen while stopped.
+//
+// Sleep-on-exit suits programs that do all their work in interrupt handlers.
+// Once it's enabled, the processor goes straight back to sleep at the end of
+// every handler, without returning to the main loop at all, which saves the
+// cost of the exception entry and exit in between.
+//
+// To measure how much time is spent in each state, PowerSleep() and
+// PowerStop() keep residency counters, using the DWT cycle counter for
+// running and sleeping time and the RTC, if it's been started, for time in
+// Stop. The cycle counter wraps after a minute at 72MHz, so read the counters
+// at least that often. Time the processor spends asleep because of
+// sleep-on-exit isn't seen by these functions, so it's counted as awake.
+
+#ifndef INCLUDE_POWER_H
+#define INCLUDE_POWER_H
+
+#include <stdint.h>
+
+#include "core_stm32.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Which edges on a pin should wake the processor.
+#define POWER_EDGE_RISING (1 << 0)
+#define POWER_EDGE_FALLING (1 << 1)
+
+typedef struct {
+  // Times are in processor cycles, at the HCLK rate.
+  uint64_t awake_cycles;
+  uint64_t sleep_cycles;
+  uint64_t stop_cycles;
+  uint32_t sleep_count;
+  uint32_t stop_count;
+} PowerResidency;
+
+// Turns on the cycle counter and the power controller's clock, and clears
+// the residency counters.
+void PowerInit(void);
+
+// Sleeps until an interrupt is pending. If interrupts are masked with
+// __disable_irq() when this is called, the processor still wakes, but the
+// handler doesn't run until they're unmasked. Doing that means a flag set by
+// a handler can be checked and slept on without a race, since an interrupt
+// that arrives after the check will still end the sleep.
+void PowerSleep(void);
+
+// Sleeps until an event arrives, with WFE. Events come from EXTI lines set
+// up in event mode, the SEV instruction, and pending interrupts if
+// PowerSetWakeOnPending() is on. If an event has arrived since the last WFE,
+// this returns immediately.
+void PowerSleepUntilEvent(void);
+
+// Makes any interrupt that becomes pending an event, even if it's disabled
+// in the NVIC, so PowerSleepUntilEvent() can wait for it.
+void PowerSetWakeOnPending(int enable);
+
+// Turns sleep-on-exit on or off.
+void PowerSetSleepOnExit(int enable);
+
+// Enters Stop mode until an EXTI line wakes us, either as an interrupt or,
+// if wait_for_event is non-zero, as an event. Interrupts are masked until
+// the clocks have been restored, so handlers run at full speed.
+void PowerStop(int wait_for_event);
+
+// Starts the RTC as a counter that keeps running in Stop, and returns its
+// tick rate. The Blue Pill's 32.768KHz crystal gives 1024 ticks a second.
+// Without the crystal, the internal low-speed oscillator gives roughly 1000,
+// but it can be off by as much as a quarter. The crystal can take a second
+// or so to start.
+uint32_t PowerRtcInit(int use_lse);
+
+// Returns the RTC's tick rate, or zero if it hasn't been started.
+uint32_t PowerRtcGetTickRate(void);
+
+// Reads the RTC counter.
+uint32_t PowerRtcGetCounter(void);
+
+// Enters Stop mode until the given number of RTC ticks has passed, or
+// another event wakes us.
+void PowerStopForTicks(uint32_t ticks);
+
+static inline void PowerStopForMilliseconds(uint32_t ms) {
+  const uint64_t ticks = ((uint64_t)(ms)*PowerRtcGetTickRate()) + 999;
+  PowerStopForTicks((uint32_t)(ticks / 1000));
+}
+
+// Lets an edge on a GPIO pin wake the processor from PowerStop() with
+// wait_for_event set, or from PowerSleepUntilEvent(). Each pin number can
+// only be used on one port at a time. edges is a combination of the
+// POWER_EDGE_* flags.
+void PowerWakeOnPin(GPIO_t* gpio, int pin, int edges);
+
+// Stops the pin from waking the processor.
+void PowerWakeOnPinOff(int pin);
+
+// Fills in the time spent in each mode since the last reset, including the
+// time since the last sleep.
+void PowerGetResidency(PowerResidency* residency);
+
+void PowerResetResidency(void);
+
+// Returns the share of time spent awake, in tenths of a percent.
+static inline uint32_t PowerAwakePermille(const PowerResidency* residency) {
+  const uint64_t total = residency->awake_cycles + residency->sleep_cycles +
+                         residency->stop_cycles;
+  if (total == 0) {
+    return 1000;
+  }
+  return (uint32_t)((residency->awake_cycles * 1000) / total);
+}
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_POWER_H
@@ -0,0 +1,125 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// A cooperative scheduler, for programs that juggle several activities that
+// each need to happen at their own times, like polling a sensor, running
+// inference, and updating an LED.
+//
+// Tasks are functions that run to completion, either once after a delay or
+// repeatedly with a fixed period. They're kept in a min-heap ordered by
+// deadline, so finding the next one is cheap however many there are. Periodic
+// deadlines advance by exactly the period each time, so they don't drift, and
+// if a task falls more than a whole period behind, the missed runs are
+// skipped and counted rather than run back to back.
+//
+// Between tasks, the scheduler is tickless. Rather than waking on a regular
+// SysTick interrupt to check whether anything is due, it sets the timebase
+// alarm for the next deadline and sleeps until then, or until some other
+// interrupt needs attention. Times are in microseconds from the timebase, so
+// call TimebaseInit() before using the scheduler.
+//
+// Everything here must be called from the main loop or from tasks, not from
+// interrupt handlers. Handlers that need to hand work over can set a flag
+// that a task polls, or use a WorkQueue.
+
+#ifndef INCLUDE_SCHEDULER_H
+#define INCLUDE_SCHEDULER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+typedef void (*TaskFunction)(void* arg);
+
+// The storage for a task is owned by the caller, and must stay around until
+// the task has finished or been cancelled.
+typedef struct {
+  TaskFunction function;
+  void* arg;
+  // When the task should next run, in timebase microseconds.
+  uint64_t deadline;
+  // Zero for one-shot tasks.
+  uint32_t period;
+  // Where the task is in the heap, if it's scheduled.
+  int heap_index;
+
+  // Statistics.
+  uint32_t run_count;
+  uint32_t skipped_count;
+  // The longest a run started after its deadline, in microseconds.
+  uint32_t max_lateness;
+} SchedulerTask;
+
+typedef struct {
+  SchedulerTask** heap;
+  int capacity;
+  int count;
+  // How many times the scheduler has gone to sleep while idle.
+  uint32_t sleep_count;
+} Scheduler;
+
+// Sets up a scheduler that can hold as many tasks at once as the heap array
+// has room for.
+void SchedulerInit(Scheduler* scheduler, SchedulerTask** heap, int capacity);
+
+// Schedules a task to run after delay microseconds, and then every period
+// microseconds after that if period is non-zero. If the task is already
+// scheduled it's moved to the new time, and keeps its statistics, which are
+// otherwise cleared. Returns zero if the scheduler is full.
+int SchedulerAdd(Scheduler* scheduler, SchedulerTask* task,
+                 TaskFunction function, void* arg, uint32_t delay,
+                 uint32_t period);
+
+static inline int SchedulerAddOneShot(Scheduler* scheduler,
+                                      SchedulerTask* task,
+                                      TaskFunction function, void* arg,
+                                      uint32_t delay) {
+  return SchedulerAdd(scheduler, task, function, arg, delay, 0);
+}
+
+static inline int SchedulerAddPeriodic(Scheduler* scheduler,
+                                       SchedulerTask* task,
+                                       TaskFunction function, void* arg,
+                                       uint32_t period) {
+  return SchedulerAdd(scheduler, task, function, arg, period, period);
+}
+
+// Stops a task from running again. This is safe to call on a task that
+// isn't scheduled, including from inside the task itself.
+void SchedulerCancel(Scheduler* scheduler, SchedulerTask* task);
+
+// Returns non-zero if the task is waiting to run. Task storage doesn't need
+// to be initialized before it's first added, so this checks the heap rather
+// than trusting the index.
+static inline int SchedulerIsScheduled(const Scheduler* scheduler,
+                                       const SchedulerTask* task) {
+  const int index = task->heap_index;
+  return (index >= 0) && (index < scheduler->count) &&
+         (scheduler->heap[index] == task);
+}
+
+// Runs every task whose deadline has passed, in deadline order, and returns
+// how many ran.
+int SchedulerRunPending(Scheduler* scheduler);
+
+// Runs any pending tasks, then sleeps until the next deadline or until an
+// interrupt arrives, whichever is sooner. Call this repeatedly from the main
+// loop, with anything else that needs polling after it.
+void SchedulerRunOnce(Scheduler* scheduler);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_SCHEDULER_H
@@ -0,0 +1,90 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Summary statistics for blocks of ADC samples, calculated in a single pass.
+//
+// All the statistics for a block are gathered while walking through the
+// samples once, reading two of them at a time with each 32-bit load. Since
+// the block size is fixed, the divisions at the end are done with shifts
+// when it's a power of two, and with a precalculated reciprocal multiply
+// otherwise.
+//
+// The mean absolute deviation and zero crossings need a reference level to
+// measure against, and finding this block's mean first would need a second
+// pass. Instead, the previous block's mean is used, which is accurate as long
+// as the DC level of the signal changes slowly compared to the block length.
+
+#ifndef INCLUDE_SIGNAL_STATS_H
+#define INCLUDE_SIGNAL_STATS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Fixed-point representation of 1.0 for the zero crossing rate.
+#define SIGNAL_STATS_RATE_ONE (1 << 15)
+
+// All values are in raw ADC units, unless otherwise noted.
+typedef struct {
+  int32_t mean;
+  // The root mean square of the signal once its mean has been removed, which
+  // is the usual measure of the loudness of an audio signal.
+  int32_t rms;
+  int32_t mean_abs_deviation;
+  int32_t min;
+  int32_t max;
+  int32_t peak_to_peak;
+  // How many times the signal crossed the reference level during the block.
+  int32_t zero_crossings;
+  // Zero crossings per sample, where SIGNAL_STATS_RATE_ONE would mean every
+  // sample was on the opposite side to the one before.
+  int32_t zero_crossing_rate;
+} SignalStats;
+
+typedef struct {
+  int block_size;
+  // log2(block_size) if it's a power of two, or -1 if not.
+  int block_shift;
+  // 2^32 / block_size, rounded up, for block sizes that aren't powers of two.
+  uint32_t block_reciprocal;
+  // The level that deviations and zero crossings are measured against.
+  int32_t center;
+  // Each new block moves the running averages 1/2^average_shift of the way
+  // towards its own values.
+  int average_shift;
+  int block_count;
+  // Exponential running averages of every statistic across blocks.
+  SignalStats average;
+  // The same averages, with 8 extra bits of precision, so small changes
+  // aren't lost to rounding.
+  SignalStats average_q8;
+} SignalStatsTracker;
+
+// Prepares to process blocks of block_size samples. block_size must be at
+// least two.
+void SignalStatsInit(SignalStatsTracker* tracker, int block_size,
+                     int average_shift);
+
+// Calculates the statistics for a block of block_size raw 12-bit ADC samples,
+// and folds them into the running averages. The samples must be 16-bit
+// aligned, and are fastest when they're 32-bit aligned too, as DMA buffers
+// usually are.
+void SignalStatsProcessAdc(SignalStatsTracker* tracker,
+                           const uint16_t* samples, SignalStats* stats);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_SIGNAL_STATS_H
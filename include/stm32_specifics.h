@@ -127,6 +127,16 @@ typedef struct {
   __IO uint32_t UNUSED7;
 } DMA_t;
 
+// The registers for a single DMA channel, which repeat at the same stride
+// inside DMA_t, so code can be written once for any channel.
+typedef struct {
+  __IO uint32_t CCR;
+  __IO uint32_t CNDTR;
+  __IO uint32_t CPAR;
+  __IO uint32_t CMAR;
+  __IO uint32_t UNUSED;
+} DMA_Channel_t;
+
 // Timer register layout.
 typedef struct {
   __IO uint32_t CR1;
@@ -151,6 +161,45 @@ typedef struct {
   __IO uint32_t DMAR;
 } TIM_t;
 
+// Power Control Layout.
+typedef struct {
+  __IO uint32_t CR;   // Power Control.
+  __IO uint32_t CSR;  // Power Control and Status.
+} PWR_t;
+
+// External Interrupt and Event Controller Layout.
+typedef struct {
+  __IO uint32_t IMR;    // Interrupt Mask.
+  __IO uint32_t EMR;    // Event Mask.
+  __IO uint32_t RTSR;   // Rising Trigger Selection.
+  __IO uint32_t FTSR;   // Falling Trigger Selection.
+  __IO uint32_t SWIER;  // Software Interrupt Event.
+  __IO uint32_t PR;     // Pending.
+} EXTI_t;
+
+// Alternate Function I/O Layout.
+typedef struct {
+  __IO uint32_t EVCR;       // Event Control.
+  __IO uint32_t MAPR;       // Remap and Debug I/O Configuration.
+  __IO uint32_t EXTICR[4];  // External Interrupt Configuration #1-#4.
+  __IO uint32_t UNUSED;     // Unused.
+  __IO uint32_t MAPR2;      // Remap and Debug I/O Configuration #2.
+} AFIO_t;
+
+// Real-Time Clock Layout. Only the bottom 16 bits of each register are used.
+typedef struct {
+  __IO uint32_t CRH;   // Control High.
+  __IO uint32_t CRL;   // Control Low.
+  __IO uint32_t PRLH;  // Prescaler Load High.
+  __IO uint32_t PRLL;  // Prescaler Load Low.
+  __IO uint32_t DIVH;  // Prescaler Divider High.
+  __IO uint32_t DIVL;  // Prescaler Divider Low.
+  __IO uint32_t CNTH;  // Counter High.
+  __IO uint32_t CNTL;  // Counter Low.
+  __IO uint32_t ALRH;  // Alarm High.
+  __IO uint32_t ALRL;  // Alarm Low.
+} RTC_t;
+
 // Addresses of peripherals.
 #define RCC_BASE ((uint32_t)0x40021000)
 #define GPIOA_BASE ((uint32_t)0x40010800)
@@ -168,6 +217,10 @@ typedef struct {
 #define FLASH_ACR_BASE ((uint32_t)0x40022000)
 #define DMA1_BASE ((uint32_t)0x40020000)
 #define DMA2_BASE ((uint32_t)0x40020400)
+#define PWR_BASE ((uint32_t)0x40007000)
+#define EXTI_BASE ((uint32_t)0x40010400)
+#define AFIO_BASE ((uint32_t)0x40010000)
+#define RTC_BASE ((uint32_t)0x40002800)
 
 // Globals for accessing peripherals.
 #define RCC ((RCC_t*)RCC_BASE)
@@ -186,6 +239,10 @@ typedef struct {
 #define TIM5 ((TIM_t*)TIM5_BASE)
 #define TIM6 ((TIM_t*)TIM6_BASE)
 #define TIM7 ((TIM_t*)TIM7_BASE)
+#define PWR ((PWR_t*)PWR_BASE)
+#define EXTI ((EXTI_t*)EXTI_BASE)
+#define AFIO ((AFIO_t*)AFIO_BASE)
+#define RTC ((RTC_t*)RTC_BASE)
 
 // GPIO settings.
 #define GPIO_MODE_OUT_2 (0x2)
@@ -207,6 +264,7 @@ typedef struct {
 #define ADC_SR_STRT (1 << 4)
 
 // ADC Control Register #1 flag values.
+#define ADC_CR1_AWDCH_MASK (0x1f << 0)
 #define ADC_CR1_EOCIE (1 << 5)
 #define ADC_CR1_AWDIE (1 << 6)
 #define ADC_CR1_JEOCIE (1 << 7)
@@ -215,6 +273,11 @@ typedef struct {
 #define ADC_CR1_JAUTO (1 << 10)
 #define ADC_CR1_DISCEN (1 << 11)
 #define ADC_CR1_JDISCEN (1 << 12)
+#define ADC_CR1_DUALMOD_MASK (0xf << 16)
+#define ADC_CR1_DUALMOD_INDEPENDENT (0 << 16)
+#define ADC_CR1_DUALMOD_REGULAR_SIMULTANEOUS (6 << 16)
+#define ADC_CR1_DUALMOD_FAST_INTERLEAVED (7 << 16)
+#define ADC_CR1_DUALMOD_SLOW_INTERLEAVED (8 << 16)
 #define ADC_CR1_JAWDEN (1 << 22)
 #define ADC_CR1_AWDEN (1 << 23)
 
@@ -226,11 +289,31 @@ typedef struct {
 #define ADC_CR2_DMA (1 << 8)
 #define ADC_CR2_ALIGN (1 << 11)
 #define ADC_CR2_JEXTTRIG (1 << 15)
+#define ADC_CR2_EXTSEL_MASK (7 << 17)
+#define ADC_CR2_EXTSEL_TIM1_CC1 (0 << 17)
+#define ADC_CR2_EXTSEL_TIM1_CC2 (1 << 17)
+#define ADC_CR2_EXTSEL_TIM1_CC3 (2 << 17)
+#define ADC_CR2_EXTSEL_TIM2_CC2 (3 << 17)
+#define ADC_CR2_EXTSEL_TIM3_TRGO (4 << 17)
+#define ADC_CR2_EXTSEL_TIM4_CC4 (5 << 17)
+#define ADC_CR2_EXTSEL_EXTI11 (6 << 17)
+#define ADC_CR2_EXTSEL_SWSTART (7 << 17)
 #define ADC_CR2_EXTTRIG (1 << 20)
 #define ADC_CR2_JSWSTART (1 << 21)
 #define ADC_CR2_SWSTART (1 << 22)
 #define ADC_CR2_TSVREFE (1 << 23)
 
+// ADC sample time values for any channel. The SMPR1 and SMPR2 flags below
+// are these values shifted into the right place for each channel.
+#define ADC_SAMPLE_TIME_1_5_CYCLES (0)
+#define ADC_SAMPLE_TIME_7_5_CYCLES (1)
+#define ADC_SAMPLE_TIME_13_5_CYCLES (2)
+#define ADC_SAMPLE_TIME_28_5_CYCLES (3)
+#define ADC_SAMPLE_TIME_41_5_CYCLES (4)
+#define ADC_SAMPLE_TIME_55_5_CYCLES (5)
+#define ADC_SAMPLE_TIME_71_5_CYCLES (6)
+#define ADC_SAMPLE_TIME_239_5_CYCLES (7)
+
 // ADC Sample Time Register #1 flag values.
 #define ADC_SMPR1_SMP10_1_5_CYCLES (0 << 0)
 #define ADC_SMPR1_SMP10_7_5_CYCLES (1 << 0)
@@ -379,10 +462,21 @@ typedef struct {
 #define ADC_SMPR2_SMP9_71_5_CYCLES (6 << 27)
 #define ADC_SMPR2_SMP9_239_5_CYCLES (7 << 27)
 
+// ADC Regular Sequence Register #1 values. The length field holds the number
+// of conversions in the sequence, minus one.
+#define ADC_SQR1_L_SHIFT (20)
+#define ADC_SQR1_L_MASK (0xf << ADC_SQR1_L_SHIFT)
+
+// ADC channels that are connected to internal sensors, rather than pins.
+// These need ADC_CR2_TSVREFE to be set.
+#define ADC_CHANNEL_TEMPERATURE (16)
+#define ADC_CHANNEL_VREFINT (17)
+
 // Flash Access Control Register flag values.
 #define FLASH_ACR_LATENCY_0 (0)
 #define FLASH_ACR_LATENCY_1 (1)
 #define FLASH_ACR_LATENCY_2 (2)
+#define FLASH_ACR_LATENCY_MASK (7)
 #define FLASH_ACR_HLFCYA (1 << 3)
 #define FLASH_ACR_PRFTBE (1 << 4)
 #define FLASH_ACR_PRFTBS (1 << 5)
@@ -401,6 +495,11 @@ typedef struct {
 #define RCC_CFGR_SW_HSI (0 << 0)
 #define RCC_CFGR_SW_HSE (1 << 0)
 #define RCC_CFGR_SW_PLL (2 << 0)
+#define RCC_CFGR_SW_MASK (3 << 0)
+#define RCC_CFGR_SWS_HSI (0 << 2)
+#define RCC_CFGR_SWS_HSE (1 << 2)
+#define RCC_CFGR_SWS_PLL (2 << 2)
+#define RCC_CFGR_SWS_MASK (3 << 2)
 #define RCC_CFGR_HPRE_DIV_NONE (0 << 4)
 #define RCC_CFGR_HPRE_DIV_2 ((1 << 7) | (0 << 4))
 #define RCC_CFGR_HPRE_DIV_4 ((1 << 7) | (1 << 4))
@@ -410,20 +509,28 @@ typedef struct {
 #define RCC_CFGR_HPRE_DIV_128 ((1 << 7) | (5 << 4))
 #define RCC_CFGR_HPRE_DIV_256 ((1 << 7) | (6 << 4))
 #define RCC_CFGR_HPRE_DIV_512 ((1 << 7) | (7 << 4))
+#define RCC_CFGR_HPRE_MASK (0xf << 4)
+#define RCC_CFGR_HPRE_SHIFT (4)
 #define RCC_CFGR_PPRE1_DIV_NONE (0 << 8)
 #define RCC_CFGR_PPRE1_DIV_2 ((1 << 10) | (0 << 8))
 #define RCC_CFGR_PPRE1_DIV_4 ((1 << 10) | (1 << 8))
 #define RCC_CFGR_PPRE1_DIV_8 ((1 << 10) | (2 << 8))
 #define RCC_CFGR_PPRE1_DIV_16 ((1 << 10) | (3 << 8))
+#define RCC_CFGR_PPRE1_MASK (7 << 8)
+#define RCC_CFGR_PPRE1_SHIFT (8)
 #define RCC_CFGR_PPRE2_DIV_NONE (0 << 11)
 #define RCC_CFGR_PPRE2_DIV_2 ((1 << 13) | (0 << 11))
 #define RCC_CFGR_PPRE2_DIV_4 ((1 << 13) | (1 << 11))
 #define RCC_CFGR_PPRE2_DIV_8 ((1 << 13) | (2 << 11))
 #define RCC_CFGR_PPRE2_DIV_16 ((1 << 13) | (3 << 11))
+#define RCC_CFGR_PPRE2_MASK (7 << 11)
+#define RCC_CFGR_PPRE2_SHIFT (11)
 #define RCC_CFGR_ADCPRE_DIV_2 (0 << 14)
 #define RCC_CFGR_ADCPRE_DIV_4 (1 << 14)
 #define RCC_CFGR_ADCPRE_DIV_6 (2 << 14)
 #define RCC_CFGR_ADCPRE_DIV_8 (3 << 14)
+#define RCC_CFGR_ADCPRE_MASK (3 << 14)
+#define RCC_CFGR_ADCPRE_SHIFT (14)
 #define RCC_CFGR_PLLSRC_HSE (1 << 16)
 #define RCC_CFGR_PLLXTPRE (1 << 17)
 #define RCC_CFGR_PLLMUL_2 (0 << 18)
@@ -441,6 +548,8 @@ typedef struct {
 #define RCC_CFGR_PLLMUL_14 (12 << 18)
 #define RCC_CFGR_PLLMUL_15 (13 << 18)
 #define RCC_CFGR_PLLMUL_16 (14 << 18)
+#define RCC_CFGR_PLLMUL_MASK (0xf << 18)
+#define RCC_CFGR_PLLMUL_SHIFT (18)
 #define RCC_CFGR_USBPRE (1 << 22)
 #define RCC_CFGR_MCO_NO_CLOCK (0 << 24)
 #define RCC_CFGR_MCO_SYS_CLOCK ((1 << 26) | (1 << 24))
@@ -481,6 +590,22 @@ typedef struct {
 #define RCC_APB1ENR_PWREN (1 << 28)
 #define RCC_APB1ENR_DACEN (1 << 29)
 
+// Reset and Clock Control Backup Domain Control Register flag values.
+#define RCC_BDCR_LSEON (1 << 0)
+#define RCC_BDCR_LSERDY (1 << 1)
+#define RCC_BDCR_LSEBYP (1 << 2)
+#define RCC_BDCR_RTCSEL_NONE (0 << 8)
+#define RCC_BDCR_RTCSEL_LSE (1 << 8)
+#define RCC_BDCR_RTCSEL_LSI (2 << 8)
+#define RCC_BDCR_RTCSEL_HSE_DIV_128 (3 << 8)
+#define RCC_BDCR_RTCSEL_MASK (3 << 8)
+#define RCC_BDCR_RTCEN (1 << 15)
+#define RCC_BDCR_BDRST (1 << 16)
+
+// Reset and Clock Control Status Register flag values.
+#define RCC_CSR_LSION (1 << 0)
+#define RCC_CSR_LSIRDY (1 << 1)
+
 // Reset and Clock Control APB2 Peripheral Clock Enable Register flag values.
 #define RCC_APB2ENR_AFIOEN (1 << 0)
 #define RCC_APB2ENR_IOPAEN (1 << 2)
@@ -620,6 +745,27 @@ typedef struct {
 #define TIM_CR2_MMS_OIS3N (1 << 13)
 #define TIM_CR2_MMS_OIS4 (1 << 14)
 
+// Timer Slave Mode Control Register.
+#define TIM_SMCR_SMS_DISABLED (0 << 0)
+#define TIM_SMCR_SMS_RESET (4 << 0)
+#define TIM_SMCR_SMS_GATED (5 << 0)
+#define TIM_SMCR_SMS_TRIGGER (6 << 0)
+#define TIM_SMCR_SMS_EXTERNAL_CLOCK (7 << 0)
+#define TIM_SMCR_SMS_MASK (7 << 0)
+#define TIM_SMCR_TS_ITR0 (0 << 4)
+#define TIM_SMCR_TS_ITR1 (1 << 4)
+#define TIM_SMCR_TS_ITR2 (2 << 4)
+#define TIM_SMCR_TS_ITR3 (3 << 4)
+#define TIM_SMCR_TS_MASK (7 << 4)
+#define TIM_SMCR_MSM (1 << 7)
+
+// Timer DMA/Interrupt Enable Register.
+#define TIM_DIER_UIE (1 << 0)
+#define TIM_DIER_CC1IE (1 << 1)
+#define TIM_DIER_CC2IE (1 << 2)
+#define TIM_DIER_CC3IE (1 << 3)
+#define TIM_DIER_CC4IE (1 << 4)
+
 // Timer Status Register flag values.
 #define TIM_SR_UIF (1 << 0)
 #define TIM_SR_CC1IF (1 << 1)
@@ -634,6 +780,54 @@ typedef struct {
 #define TIM_SR_CC3OF (1 << 9)
 #define TIM_SR_CC4OF (1 << 9)
 
+// Timer Event Generation Register.
+#define TIM_EGR_UG (1 << 0)
+
+// Timer Capture/Compare Mode Registers.
+#define TIM_CCMR_OC_PWM1 (6)
+#define TIM_CCMR1_OC1M_SHIFT (4)
+#define TIM_CCMR1_OC2M_SHIFT (12)
+#define TIM_CCMR2_OC3M_SHIFT (4)
+#define TIM_CCMR2_OC4M_SHIFT (12)
+
+// Timer Capture/Compare Enable Register.
+#define TIM_CCER_CC1E (1 << 0)
+#define TIM_CCER_CC2E (1 << 4)
+#define TIM_CCER_CC3E (1 << 8)
+#define TIM_CCER_CC4E (1 << 12)
+
+// Power Control Register.
+#define PWR_CR_LPDS (1 << 0)
+#define PWR_CR_PDDS (1 << 1)
+#define PWR_CR_CWUF (1 << 2)
+#define PWR_CR_CSBF (1 << 3)
+#define PWR_CR_DBP (1 << 8)
+
+// Power Control and Status Register.
+#define PWR_CSR_WUF (1 << 0)
+#define PWR_CSR_SBF (1 << 1)
+
+// EXTI lines that aren't GPIO pins.
+#define EXTI_LINE_PVD (16)
+#define EXTI_LINE_RTC_ALARM (17)
+#define EXTI_LINE_USB_WAKEUP (18)
+
+// AFIO EXTI configuration values, selecting the GPIO port for a line.
+#define AFIO_EXTICR_PORT_A (0)
+#define AFIO_EXTICR_PORT_B (1)
+#define AFIO_EXTICR_PORT_C (2)
+
+// Real-Time Clock Control Registers.
+#define RTC_CRH_SECIE (1 << 0)
+#define RTC_CRH_ALRIE (1 << 1)
+#define RTC_CRH_OWIE (1 << 2)
+#define RTC_CRL_SECF (1 << 0)
+#define RTC_CRL_ALRF (1 << 1)
+#define RTC_CRL_OWF (1 << 2)
+#define RTC_CRL_RSF (1 << 3)
+#define RTC_CRL_CNF (1 << 4)
+#define RTC_CRL_RTOFF (1 << 5)
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif  // __cplusplus
@@ -0,0 +1,96 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// A monotonic microsecond clock, for timing things that take longer than the
+// 65 milliseconds a single 16-bit timer can cover at that resolution.
+//
+// TIM2 is prescaled to count microseconds, and each time it overflows its
+// update event is sent through the internal trigger connection to TIM4, which
+// is set up as a slave in external clock mode, so it counts the overflows.
+// Together they make a 32-bit hardware counter that wraps after 71 minutes,
+// with no interrupts involved. An interrupt on TIM4's own overflow extends
+// that to 64 bits.
+//
+// An alarm can be set to wake the processor at a given time, using the
+// compare channel 1 of both timers. TIM4's compare fires in the right 65ms
+// window, and then TIM2's fires on the exact microsecond, so a distant alarm
+// costs no interrupts in between. The handlers don't do anything else, so
+// the alarm is only useful for ending a sleep, after which the caller checks
+// the time for itself.
+//
+// This uses TIM2 and TIM4, so neither can be used for anything else, or as
+// an ADC trigger. TimebaseInit() installs its own handlers for both, using
+// the SRAM vector table from vector_table.h. The prescaler is calculated from
+// the clocks at the time TimebaseInit() is called, so set the clocks up
+// first. The timers don't run during Stop mode.
+
+#ifndef INCLUDE_TIMEBASE_H
+#define INCLUDE_TIMEBASE_H
+
+#include <stdint.h>
+
+#include "interrupts.h"
+#include "timers.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// How many times the 32-bit count has wrapped. Only TIM4's interrupt
+// handler in source/timebase.c changes this.
+extern volatile uint32_t g_timebase_overflow_count;
+
+// Starts counting from zero.
+void TimebaseInit(void);
+
+// Returns the number of microseconds since TimebaseInit(). This is safe to
+// call from anywhere, including interrupt handlers, without disabling
+// interrupts.
+static inline uint32_t TimebaseGet32(void) {
+  uint32_t high;
+  uint32_t low;
+  // If TIM4 moved on while we were reading TIM2, try again. TIM4 also takes
+  // a couple of timer clocks to see TIM2's overflow, so don't trust a reading
+  // from the first microsecond after one, when TIM2 is zero.
+  do {
+    high = TIM4->CNT;
+    low = TIM2->CNT;
+  } while ((low == 0) || (high != TIM4->CNT));
+  return (high << 16) | low;
+}
+
+// Returns the number of microseconds since TimebaseInit(), without ever
+// wrapping. This is also safe to call from anywhere, even with interrupts
+// disabled, for up to 71 minutes at a time.
+uint64_t TimebaseGet64(void);
+
+// Wakes the processor with an interrupt once TimebaseGet64() reaches
+// deadline, replacing any earlier alarm. A deadline that has already passed
+// fires straight away.
+void TimebaseSetAlarm(uint64_t deadline);
+
+// Turns off any alarm that hasn't fired yet.
+void TimebaseCancelAlarm(void);
+
+// Changes the priority of both timers' interrupts. The alarm relies on them
+// never preempting each other, so always set them together with this rather
+// than with InterruptSetPriority().
+static inline void TimebaseSetInterruptPriority(int preempt) {
+  InterruptSetPriority(TIM2_IRQn, preempt, 0);
+  InterruptSetPriority(TIM4_IRQn, preempt, 0);
+}
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_TIMEBASE_H
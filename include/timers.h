@@ -17,13 +17,16 @@ limitations under the License.
 
 #include <stdint.h>
 
+#include "clocks.h"
 #include "core_stm32.h"
+#include "delay.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif  // __cplusplus
 
-// We know the "Blue Pill" STM32 board runs at 72 MHz.
+// The fastest the "Blue Pill" STM32 board can run. The actual rate depends on
+// how the clocks have been set up, so use ClockGetHclkRate() to find it.
 #define CLOCK_RATE (72 * 1000 * 1000)
 
 // There's a default SysTick handler function defined in source/timers.c that
@@ -34,14 +37,14 @@ extern uint32_t g_tick_count;
 typedef void (*OnSysTickCallback)(int tick_count);
 extern OnSysTickCallback g_tick_callback;
 
-// Spin in a loop for roughly the specified number of microseconds. This is
-// using instruction timing, so it's not precise, and the processor will be
-// consuming power while this is running.
+// Spins for the specified number of microseconds. This used to count loop
+// iterations, but is now a wrapper for DelayMicroseconds(), which is timed
+// by the cycle counter. The processor will be consuming power while this is
+// running.
 static inline void BusyWaitMicroseconds(int32_t us) {
-  // Each loop takes very roughly one microsecond on a Blue Pill.
-  volatile int32_t count = us;
-  for (; count > 0; --count)
-    ;
+  if (us > 0) {
+    DelayMicroseconds(us);
+  }
 }
 
 // Indexes for the different timers.
@@ -70,8 +73,9 @@ static inline TIM_t* TimerIdToStruct(int timer_id) {
   return id_to_struct_lookup[timer_id];
 }
 
-// Initializes the given timer to count up every millisecond.
-static inline void TimerInit(int timer_id) {
+// Turns on the clock for a timer, which has to happen before its registers
+// can be accessed.
+static inline void TimerEnableClock(int timer_id) {
   // We need different flags to turn on the different timers, so look them up
   // from a table and apply them to the correct register.
   static const uint32_t id_to_flag_lookup[] = {
@@ -87,23 +91,86 @@ static inline void TimerInit(int timer_id) {
   } else {
     RCC->APB1ENR |= flag;
   }
+}
+
+// Returns the rate of the clock feeding a timer. TIM1 and TIM8-11 are on
+// APB2, and the rest are on APB1. Either way, the timers run at twice their
+// bus clock unless the bus is running at the full HCLK rate.
+static inline uint32_t TimerGetClockRate(int timer_id) {
+  uint32_t bus_rate;
+  if ((timer_id == TIMERID_TIM1) || (timer_id > TIMERID_TIM7)) {
+    bus_rate = ClockGetPclk2Rate();
+  } else {
+    bus_rate = ClockGetPclk1Rate();
+  }
+  if (bus_rate == ClockGetHclkRate()) {
+    return bus_rate;
+  }
+  return bus_rate * 2;
+}
+
+// Initializes the given timer to count up a whole number of times every
+// millisecond, and returns how many, or zero if the timer's clock can't be
+// divided down exactly. This is usually one, but the prescaler is only 16
+// bits, so once the timer clock is above 65.536MHz, as it is for the APB1
+// timers at the full 72MHz, the counter has to run faster, and counts two per
+// millisecond. The counter wraps after 65536 counts, so for timing use the
+// microsecond clock in timebase.h instead.
+static inline int TimerInit(int timer_id) {
+  const uint32_t clock_rate = TimerGetClockRate(timer_id);
+  int ticks_per_ms = 1;
+  while (((clock_rate % (1000 * ticks_per_ms)) != 0) ||
+         ((clock_rate / (1000 * ticks_per_ms)) > 0x10000)) {
+    ++ticks_per_ms;
+    if (ticks_per_ms > 16) {
+      return 0;
+    }
+  }
 
-  // Now we do some math to determine how fast the counter increments.
-  // The prescale (PSC) value is what the timer clock is divided by, and
-  // the timer clock is derived from the the system clock either divided
-  // by 1, 2, or 4 (set by the TIM_CR1_CKD_DIV* flag).
+  TimerEnableClock(timer_id);
+  // The prescale (PSC) value is what the timer clock is divided by, plus
+  // one.
   TIM_t* tim = TimerIdToStruct(timer_id);
-  // Prescaled is 72,000 /4.
-  tim->PSC = 18000;
+  tim->PSC = (clock_rate / (1000 * ticks_per_ms)) - 1;
   tim->ARR = 0xffff;
   tim->CR1 = TIM_CR1_DIR_UP | TIM_CR1_CMS_EDGE | TIM_CR1_CKD_DIV4;
+  // The prescaler only picks up new values on an update event, so force one.
+  tim->EGR = TIM_EGR_UG;
   // Once everything's set up, turn the timer on.
   tim->CR1 |= TIM_CR1_CEN;
+  return ticks_per_ms;
+}
+
+// Sets up a timer to overflow rate times a second, given the rate of the
+// clock feeding it from TimerGetClockRate(), and returns the rate it actually
+// achieved. The prescaler is kept as small as possible, so the counter has
+// the finest resolution and the result is as close as possible to what was
+// asked for. The timer isn't started, so the caller can configure its
+// outputs first and then set TIM_CR1_CEN.
+static inline int32_t TimerInitForRate(int timer_id, int32_t rate,
+                                       int32_t timer_clock_rate) {
+  TimerEnableClock(timer_id);
+  TIM_t* tim = TimerIdToStruct(timer_id);
+  // Round the overall divider to the nearest whole number.
+  uint32_t divider = (timer_clock_rate + (rate / 2)) / rate;
+  if (divider < 1) {
+    divider = 1;
+  }
+  const uint32_t prescale = (divider - 1) / 0x10000;
+  const uint32_t reload =
+      ((divider + ((prescale + 1) / 2)) / (prescale + 1)) - 1;
+  tim->CR1 = TIM_CR1_DIR_UP | TIM_CR1_CMS_EDGE | TIM_CR1_CKD_DIV1;
+  tim->PSC = prescale;
+  tim->ARR = reload;
+  // The prescaler only picks up new values on an update event, so force one.
+  tim->EGR = TIM_EGR_UG;
+  const uint32_t period = (prescale + 1) * (reload + 1);
+  return (timer_clock_rate + (period / 2)) / period;
 }
 
 // Returns the current value of a timer's counter. This is only 16 bits, so it
-// will overflow quickly (for example after 65 seconds, with the default setup
-// above of incrementing every millisecond).
+// will overflow quickly (for example after 33 seconds, with the setup above
+// counting twice a millisecond from a 72MHz timer clock).
 static inline uint16_t TimerGetCounter(int timer_id) {
   TIM_t* tim = TimerIdToStruct(timer_id);
   return tim->CNT;
@@ -0,0 +1,95 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Energy-based voice activity detection, to decide whether a block of audio
+// is worth running more expensive feature extraction and inference on.
+//
+// The detector works from the per-block statistics calculated by
+// signal_stats.h, so it costs almost nothing on top of them. It keeps an
+// estimate of the background noise level that drops quickly when the signal
+// gets quieter, and creeps up slowly when it's louder, so it follows changes
+// in the environment without being dragged up by speech. A block is active
+// when its RMS is well above the noise floor, and its zero crossing rate
+// isn't so high that it's more likely to be hiss. Once triggered, the
+// detector stays active for a few more blocks (the "hangover"), so quiet
+// syllables at the end of words aren't cut off.
+
+#ifndef INCLUDE_VAD_H
+#define INCLUDE_VAD_H
+
+#include <stdint.h>
+
+#include "signal_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Fixed-point representation of 1.0 for the duty cycle.
+#define VAD_DUTY_CYCLE_ONE (1 << 15)
+
+// Reasonable defaults for 512-sample blocks at 16KHz, which are 32ms long.
+// Speech needs to be twice the noise level, and the detector holds on for
+// around a quarter of a second afterwards.
+#define VAD_DEFAULT_THRESHOLD_RATIO_Q8 (2 * 256)
+#define VAD_DEFAULT_HANGOVER_BLOCKS (8)
+#define VAD_DEFAULT_MIN_RMS (4)
+#define VAD_DEFAULT_MAX_ZERO_CROSSING_RATE (SIGNAL_STATS_RATE_ONE / 2)
+
+typedef struct {
+  // How many times louder than the noise floor a block must be to trigger,
+  // with 256 meaning 1.0.
+  int32_t threshold_ratio_q8;
+  // Blocks quieter than this never trigger, so a near-silent input with a
+  // tiny noise floor doesn't trigger on every click.
+  int32_t min_rms;
+  // Blocks with more zero crossings per sample than this are treated as
+  // noise, however loud they are.
+  int32_t max_zero_crossing_rate;
+  int hangover_blocks;
+
+  // The estimated background RMS level, with 8 bits of fractional precision.
+  int32_t noise_floor_q8;
+  int hangover_remaining;
+  int is_active;
+
+  // Totals used to calculate the duty cycle.
+  uint32_t block_count;
+  uint32_t active_block_count;
+} VoiceActivityDetector;
+
+// Sets up a detector with the given settings. See the VAD_DEFAULT_* values
+// for a starting point.
+void VadInit(VoiceActivityDetector* vad, int32_t threshold_ratio_q8,
+             int32_t min_rms, int32_t max_zero_crossing_rate,
+             int hangover_blocks);
+
+// Updates the detector with the statistics for the latest block, and returns
+// non-zero if the block should be treated as containing voice.
+int VadUpdate(VoiceActivityDetector* vad, const SignalStats* stats);
+
+// Returns the fraction of blocks so far that were active, where
+// VAD_DUTY_CYCLE_ONE means all of them. This is the fraction of the time that
+// downstream processing gated on the detector actually has to run.
+int32_t VadGetDutyCycle(const VoiceActivityDetector* vad);
+
+// Clears the duty cycle totals, without affecting the detection state.
+static inline void VadResetDutyCycle(VoiceActivityDetector* vad) {
+  vad->block_count = 0;
+  vad->active_block_count = 0;
+}
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_VAD_H
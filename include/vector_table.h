@@ -0,0 +1,65 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Installing interrupt handlers at runtime.
+//
+// Normally handlers are chosen at link time, by defining one of the weak
+// On*Interrupt() functions from source/startup.c. That's fine when a program
+// always wants the same handler, but not when a driver wants to pick one
+// when it's set up, or swap between handlers as it changes mode. Rather than
+// a fixed handler that calls through a function pointer, this copies the
+// vector table into SRAM and points SCB->VTOR at it, so installed handlers
+// are called directly by the hardware, with no extra indirection.
+//
+// The copy takes 304 bytes of SRAM, aligned to 512 bytes as VTOR requires,
+// which is only linked in by programs that use these functions. Some of the
+// library's drivers install their handlers this way, like the DMA
+// memory-to-memory transfers and the timebase, so that defining a handler
+// in a program never clashes with one in the library.
+
+#ifndef INCLUDE_VECTOR_TABLE_H
+#define INCLUDE_VECTOR_TABLE_H
+
+#include "core_stm32.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// The system exceptions, including the initial stack pointer, followed by
+// the peripheral interrupts.
+#define VECTOR_TABLE_SYSTEM_COUNT (16)
+#define VECTOR_TABLE_COUNT (VECTOR_TABLE_SYSTEM_COUNT + IRQ_COUNT)
+
+typedef void (*VectorHandler)(void);
+
+// Copies the current vector table into SRAM and switches to it. Interrupts
+// are disabled while this happens. Calling it again does nothing.
+void VectorTableRelocate(void);
+
+// Returns non-zero if the vector table is in SRAM.
+int VectorTableIsRelocated(void);
+
+// Installs a handler for an interrupt, or for a system exception if irq is
+// negative, relocating the table first if needed, and returns the handler
+// it replaced. The new handler is used from the next time the interrupt is
+// taken.
+VectorHandler VectorTableSetHandler(IRQn_Type irq, VectorHandler handler);
+
+// Returns the handler that will be called for an interrupt.
+VectorHandler VectorTableGetHandler(IRQn_Type irq);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_VECTOR_TABLE_H
@@ -0,0 +1,60 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Runs a kernel over weights stored in flash, a tile at a time, while DMA
+// copies the next tile into SRAM in the background.
+//
+// At 72MHz flash needs two wait states, so kernels like matrix multiplies
+// and convolutions that stream their weights straight out of flash stall on
+// loads the prefetch buffer can't cover. Splitting the weights into tiles
+// and double-buffering them in SRAM means the kernel only ever reads from
+// zero wait state memory, and the cost of each copy is hidden behind the
+// computation on the previous tile.
+//
+// The weights are treated as an array of rows, all the same size, such as
+// the rows of a transposed GEMM weight matrix or the filters of a
+// convolution. Tiles are whole numbers of rows, sized to fit two of them in
+// the scratch buffer the caller provides. If no DMA channel is free, the
+// kernel is run on the weights directly from flash instead, in the same
+// tiles, so the results are the same either way.
+
+#ifndef INCLUDE_WEIGHT_PREFETCH_H
+#define INCLUDE_WEIGHT_PREFETCH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Called for each tile, with the tile's weights, the index of its first row,
+// and how many rows it holds.
+typedef void (*WeightTileFunction)(const uint8_t* tile, int first_row,
+                                   int row_count, void* arg);
+
+// Returns how many rows fit in each tile, given the scratch space available,
+// or zero if it can't hold two rows.
+int WeightPrefetchRowsPerTile(int row_bytes, int row_count, int scratch_bytes);
+
+// Calls function on every tile of the weights in order, prefetching each
+// tile into scratch while the one before it is being processed. The scratch
+// buffer should be word-aligned for the fastest copies. Returns the number of
+// tiles processed, or zero if the scratch buffer is too small.
+int WeightPrefetchRun(const uint8_t* weights, int row_bytes, int row_count,
+                      uint8_t* scratch, int scratch_bytes,
+                      WeightTileFunction function, void* arg);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_WEIGHT_PREFETCH_H
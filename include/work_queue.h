@@ -0,0 +1,106 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Deferred work for interrupt handlers, so they can do the minimum needed to
+// service the hardware and leave anything slow to run later, without
+// blocking other interrupts or adding jitter to them.
+//
+// Handlers post small work items, each a function and an argument, to a
+// lock-free queue. Any number of handlers can post at once, even when they
+// preempt each other, since the queue is built on the MpscRing from
+// atomic.h. Items are run in order by a single consumer, which is either the
+// PendSV exception, at the lowest priority so it runs as soon as no other
+// handler is active, or the main loop.
+//
+// To run items from PendSV, pass a non-zero use_pend_sv to WorkQueueInit(),
+// and define a PendSV handler in your program that runs the queue:
+//
+// void OnPendSV() { WorkQueueRunPending(&g_work_queue); }
+//
+// Otherwise, call WorkQueueRunPending() regularly from the main loop.
+//
+// The queue records how long each item waited between being posted and
+// starting to run, in processor cycles, along with the most items that were
+// ever waiting at once and how many were dropped because the queue was full.
+// These are the numbers to watch when sizing the queue and deciding how much
+// work is safe to defer.
+
+#ifndef INCLUDE_WORK_QUEUE_H
+#define INCLUDE_WORK_QUEUE_H
+
+#include <stdint.h>
+
+#include "atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+typedef void (*WorkFunction)(void* arg);
+
+typedef struct {
+  WorkFunction function;
+  void* arg;
+  // The cycle counter when the item was posted.
+  uint32_t post_cycles;
+  // The ring's sequence number for this slot.
+  volatile uint32_t sequence;
+} WorkItem;
+
+typedef struct {
+  WorkItem* items;
+  MpscRing ring;
+  int use_pend_sv;
+
+  // Statistics. The first three are updated by producers, so they're only
+  // ever changed atomically.
+  volatile uint32_t posted_count;
+  volatile uint32_t dropped_count;
+  volatile uint32_t high_water;
+  uint32_t run_count;
+  uint32_t max_latency_cycles;
+  uint64_t total_latency_cycles;
+} WorkQueue;
+
+// Sets up a queue using the given array of items for storage. The capacity
+// must be a power of two. The cycle counter is enabled, since it's used to
+// measure latency. If use_pend_sv is non-zero, posting an item triggers
+// PendSV, which is set to the lowest priority.
+void WorkQueueInit(WorkQueue* queue, WorkItem* items, int capacity,
+                   int use_pend_sv);
+
+// Adds an item to the queue. This is safe to call from any interrupt
+// handler, or from the main loop. Returns zero if the queue was full and the
+// item was dropped.
+int WorkQueuePost(WorkQueue* queue, WorkFunction function, void* arg);
+
+// Runs all the items that are ready, in the order they were posted, and
+// returns how many were run. This must only be called from one place, either
+// the PendSV handler or the main loop.
+int WorkQueueRunPending(WorkQueue* queue);
+
+// Clears all the statistics.
+void WorkQueueResetStats(WorkQueue* queue);
+
+// Returns the mean number of cycles items waited before running.
+static inline uint32_t WorkQueueAverageLatency(const WorkQueue* queue) {
+  if (queue->run_count == 0) {
+    return 0;
+  }
+  return (uint32_t)(queue->total_latency_cycles / queue->run_count);
+}
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // INCLUDE_WORK_QUEUE_H
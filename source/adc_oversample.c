@@ -0,0 +1,109 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "adc_oversample.h"
+
+// Each half of a 32-bit word can hold the sum of 16 12-bit samples without
+// overflowing into the other half, since 16 * 4095 is less than 65536.
+#define MAX_PACKED_PAIRS (16)
+
+void AdcOversamplerInit(AdcOversampler* oversampler, int extra_bits) {
+  if (extra_bits < ADC_OVERSAMPLE_MIN_EXTRA_BITS) {
+    extra_bits = ADC_OVERSAMPLE_MIN_EXTRA_BITS;
+  } else if (extra_bits > ADC_OVERSAMPLE_MAX_EXTRA_BITS) {
+    extra_bits = ADC_OVERSAMPLE_MAX_EXTRA_BITS;
+  }
+  oversampler->extra_bits = extra_bits;
+  oversampler->samples_per_output = 1 << (extra_bits * 2);
+  AdcOversamplerReset(oversampler);
+}
+
+void AdcOversamplerReset(AdcOversampler* oversampler) {
+  oversampler->accumulator = 0;
+  oversampler->accumulated_count = 0;
+}
+
+// Adds up to MAX_PACKED_PAIRS words of sample pairs in both halves at once,
+// then splits the halves apart.
+static inline uint32_t SumPackedPairs(const uint32_t* pairs, int pair_count) {
+  uint32_t packed = 0;
+  if (pair_count == MAX_PACKED_PAIRS) {
+    // Unrolled for the common case of a whole run.
+    packed += pairs[0] + pairs[1] + pairs[2] + pairs[3];
+    packed += pairs[4] + pairs[5] + pairs[6] + pairs[7];
+    packed += pairs[8] + pairs[9] + pairs[10] + pairs[11];
+    packed += pairs[12] + pairs[13] + pairs[14] + pairs[15];
+  } else {
+    for (int i = 0; i < pair_count; ++i) {
+      packed += pairs[i];
+    }
+  }
+  return (packed & 0xffff) + (packed >> 16);
+}
+
+// Returns the sum of a run of samples, which may start at any alignment.
+static uint32_t SumSamples(const uint16_t* samples, int count) {
+  uint32_t total = 0;
+  const uint16_t* current = samples;
+  const uint16_t* const end = samples + count;
+  // Step forward a single sample if needed, so we can use 32-bit loads.
+  if (((((uintptr_t)(current)) & 3) != 0) && (current != end)) {
+    total += *current;
+    ++current;
+  }
+  const uint32_t* pairs = (const uint32_t*)(current);
+  int pair_count = (end - current) / 2;
+  current += (pair_count * 2);
+  while (pair_count >= MAX_PACKED_PAIRS) {
+    total += SumPackedPairs(pairs, MAX_PACKED_PAIRS);
+    pairs += MAX_PACKED_PAIRS;
+    pair_count -= MAX_PACKED_PAIRS;
+  }
+  total += SumPackedPairs(pairs, pair_count);
+  if (current != end) {
+    total += *current;
+  }
+  return total;
+}
+
+int AdcOversamplerProcess(AdcOversampler* oversampler,
+                          const uint16_t* samples, int sample_count,
+                          uint16_t* outputs) {
+  const int samples_per_output = oversampler->samples_per_output;
+  const int extra_bits = oversampler->extra_bits;
+  uint32_t accumulator = oversampler->accumulator;
+  int accumulated_count = oversampler->accumulated_count;
+  int output_count = 0;
+
+  const uint16_t* current = samples;
+  int remaining = sample_count;
+  while (remaining > 0) {
+    int run_count = samples_per_output - accumulated_count;
+    if (run_count > remaining) {
+      run_count = remaining;
+    }
+    accumulator += SumSamples(current, run_count);
+    current += run_count;
+    remaining -= run_count;
+    accumulated_count += run_count;
+    if (accumulated_count == samples_per_output) {
+      outputs[output_count] = accumulator >> extra_bits;
+      ++output_count;
+      accumulator = 0;
+      accumulated_count = 0;
+    }
+  }
+
+  oversampler->accumulator = accumulator;
+  oversampler->accumulated_count = accumulated_count;
+  return output_count;
+}
@@ -0,0 +1,111 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "atomic.h"
+
+void SpscRingInit(SpscRing* ring, uint32_t* values, int capacity) {
+  ring->values = values;
+  ring->capacity = capacity;
+  ring->head = 0;
+  ring->tail = 0;
+}
+
+int SpscRingPush(SpscRing* ring, uint32_t value) {
+  const uint32_t head = ring->head;
+  if ((head - ring->tail) >= ring->capacity) {
+    return 0;
+  }
+  ring->values[head & (ring->capacity - 1)] = value;
+  // Make sure the value is written before the consumer can see it.
+  __DMB();
+  ring->head = head + 1;
+  return 1;
+}
+
+int SpscRingPop(SpscRing* ring, uint32_t* value) {
+  const uint32_t tail = ring->tail;
+  if (ring->head == tail) {
+    return 0;
+  }
+  __DMB();
+  *value = ring->values[tail & (ring->capacity - 1)];
+  // Make sure we've read the value before the producer can overwrite it.
+  __DMB();
+  ring->tail = tail + 1;
+  return 1;
+}
+
+// A slot at position p is free for a producer when its sequence is p, and
+// ready for the consumer when it's p + 1. Once it's been read, it's set to
+// p + capacity, which frees it for the next time round the ring.
+static inline volatile uint32_t* GetSequence(MpscRing* ring,
+                                             uint32_t position) {
+  const uint32_t offset = MpscRingSlot(ring, position) * ring->sequence_stride;
+  return (volatile uint32_t*)((volatile uint8_t*)(ring->sequences) + offset);
+}
+
+void MpscRingInit(MpscRing* ring, volatile uint32_t* sequences,
+                  int sequence_stride, int capacity) {
+  ring->sequences = sequences;
+  ring->sequence_stride = sequence_stride;
+  ring->capacity = capacity;
+  ring->head = 0;
+  ring->tail = 0;
+  for (int i = 0; i < capacity; ++i) {
+    *GetSequence(ring, i) = i;
+  }
+}
+
+int MpscRingClaim(MpscRing* ring, uint32_t* position) {
+  while (1) {
+    const uint32_t head = ring->head;
+    const int32_t difference = (int32_t)(*GetSequence(ring, head) - head);
+    if (difference == 0) {
+      // The slot is free, so try to claim it. If another producer got there
+      // first, the head will have moved and we'll go round again.
+      if (AtomicCompareAndSwap(&ring->head, head, head + 1)) {
+        *position = head;
+        return 1;
+      }
+    } else if (difference < 0) {
+      // The slot still holds an item from the last time round, so we're
+      // full.
+      return 0;
+    }
+    // Otherwise another producer claimed this slot after we read the head,
+    // so try again with the new head.
+  }
+}
+
+void MpscRingPublish(MpscRing* ring, uint32_t position) {
+  // Make sure the slot's data is written before the consumer can see it.
+  __DMB();
+  *GetSequence(ring, position) = position + 1;
+}
+
+int MpscRingPeek(MpscRing* ring, uint32_t* position) {
+  const uint32_t tail = ring->tail;
+  if (*GetSequence(ring, tail) != (tail + 1)) {
+    return 0;
+  }
+  __DMB();
+  *position = tail;
+  return 1;
+}
+
+void MpscRingRelease(MpscRing* ring) {
+  const uint32_t tail = ring->tail;
+  // Make sure we've read the slot's data before a producer can reuse it.
+  __DMB();
+  *GetSequence(ring, tail) = tail + ring->capacity;
+  ring->tail = tail + 1;
+}
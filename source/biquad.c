@@ -0,0 +1,143 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "biquad.h"
+
+static inline int32_t SaturateToInt32(int64_t value) {
+  if (value > INT32_MAX) {
+    return INT32_MAX;
+  } else if (value < INT32_MIN) {
+    return INT32_MIN;
+  }
+  return value;
+}
+
+// Rounds a Q31 value to the nearest Q15, clamping to the int16_t range.
+static inline int16_t RoundQ31ToQ15(int32_t value) {
+  const int32_t result = (int32_t)(((int64_t)(value) + (1 << 15)) >> 16);
+  if (result > INT16_MAX) {
+    return INT16_MAX;
+  }
+  return result;
+}
+
+void BiquadCascadeInit(BiquadCascade* cascade, enum BiquadForm form,
+                       const int16_t* coefficients, int section_count,
+                       int channel_count, int post_shift, int32_t* state) {
+  cascade->form = form;
+  cascade->coefficients = coefficients;
+  cascade->section_count = section_count;
+  cascade->channel_count = channel_count;
+  cascade->post_shift = post_shift;
+  cascade->state = state;
+  BiquadCascadeReset(cascade);
+}
+
+void BiquadCascadeReset(BiquadCascade* cascade) {
+  const int state_count = BIQUAD_STATE_COUNT(cascade->form) *
+                          cascade->section_count * cascade->channel_count;
+  for (int i = 0; i < state_count; ++i) {
+    cascade->state[i] = 0;
+  }
+}
+
+// Runs one Q31 sample through every section of a direct form I cascade. The
+// state for each section is stored as {x[n-1], x[n-2], y[n-1], y[n-2]}.
+static inline int32_t ProcessSampleDf1(const int16_t* coefficients,
+                                       int32_t* state, int section_count,
+                                       int shift, int32_t x) {
+  for (int section = 0; section < section_count; ++section) {
+    const int32_t x1 = state[0];
+    const int32_t x2 = state[1];
+    const int32_t y1 = state[2];
+    const int32_t y2 = state[3];
+    int64_t total = (int64_t)(coefficients[0]) * x;
+    total += (int64_t)(coefficients[1]) * x1;
+    total += (int64_t)(coefficients[2]) * x2;
+    total += (int64_t)(coefficients[3]) * y1;
+    total += (int64_t)(coefficients[4]) * y2;
+    const int32_t y = SaturateToInt32(total >> shift);
+    state[0] = x;
+    state[1] = x1;
+    state[2] = y;
+    state[3] = y1;
+    x = y;
+    coefficients += BIQUAD_COEFFICIENT_COUNT;
+    state += 4;
+  }
+  return x;
+}
+
+// Runs one Q31 sample through every section of a transposed direct form II
+// cascade. The two state values per section are held in Q31.
+static inline int32_t ProcessSampleTdf2(const int16_t* coefficients,
+                                        int32_t* state, int section_count,
+                                        int shift, int32_t x) {
+  for (int section = 0; section < section_count; ++section) {
+    const int64_t s1 = (int64_t)(state[0]) << shift;
+    const int64_t s2 = (int64_t)(state[1]) << shift;
+    const int32_t y =
+        SaturateToInt32(((int64_t)(coefficients[0]) * x + s1) >> shift);
+    const int64_t next_s1 = (int64_t)(coefficients[1]) * x +
+                            (int64_t)(coefficients[3]) * y + s2;
+    const int64_t next_s2 =
+        (int64_t)(coefficients[2]) * x + (int64_t)(coefficients[4]) * y;
+    state[0] = SaturateToInt32(next_s1 >> shift);
+    state[1] = SaturateToInt32(next_s2 >> shift);
+    x = y;
+    coefficients += BIQUAD_COEFFICIENT_COUNT;
+    state += 2;
+  }
+  return x;
+}
+
+void BiquadCascadeProcess(BiquadCascade* cascade, int16_t* data,
+                          int frame_count) {
+  const int16_t* coefficients = cascade->coefficients;
+  const int section_count = cascade->section_count;
+  const int channel_count = cascade->channel_count;
+  const int shift = 15 - cascade->post_shift;
+  const int channel_state_count =
+      BIQUAD_STATE_COUNT(cascade->form) * section_count;
+  for (int channel = 0; channel < channel_count; ++channel) {
+    int32_t* state = cascade->state + (channel * channel_state_count);
+    int16_t* current = data + channel;
+    int16_t* const end = current + (frame_count * channel_count);
+    if (cascade->form == BIQUAD_DIRECT_FORM_1) {
+      for (; current < end; current += channel_count) {
+        const int32_t x = (int32_t)(*current) << 16;
+        *current = RoundQ31ToQ15(
+            ProcessSampleDf1(coefficients, state, section_count, shift, x));
+      }
+    } else {
+      for (; current < end; current += channel_count) {
+        const int32_t x = (int32_t)(*current) << 16;
+        *current = RoundQ31ToQ15(
+            ProcessSampleTdf2(coefficients, state, section_count, shift, x));
+      }
+    }
+  }
+}
+
+int16_t* BiquadCascadeProcessAdc(BiquadCascade* cascade, uint16_t* data,
+                                 int frame_count) {
+  const int sample_count = frame_count * cascade->channel_count;
+  int16_t* const signed_data = (int16_t*)(data);
+  // A 12-bit sample with the offset removed fits in Q15 after a shift by 4,
+  // and the signed result can be written straight back over the unsigned
+  // input, so the conversion needs no extra buffer.
+  for (int i = 0; i < sample_count; ++i) {
+    signed_data[i] = ((int32_t)(data[i]) - BIQUAD_ADC_OFFSET) << 4;
+  }
+  BiquadCascadeProcess(cascade, signed_data, frame_count);
+  return signed_data;
+}
@@ -0,0 +1,239 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "clocks.h"
+
+// The dividers each prescaler field supports, in the order of their
+// encodings. The AHB and APB fields use zero for no division, and then a set
+// top bit with the index below it.
+static const uint16_t g_ahb_dividers[] = {2, 4, 8, 16, 64, 128, 256, 512};
+#define AHB_DIVIDER_COUNT (8)
+#define APB_DIVIDER_COUNT (4)
+
+void ClockGetProfile(int profile, ClockConfig* config) {
+  if (profile == CLOCK_PROFILE_48MHZ) {
+    config->use_hse = 1;
+    config->pll_multiplier = 6;
+    config->ahb_divider = 1;
+    config->apb1_divider = 2;
+    config->apb2_divider = 1;
+    config->adc_divider = 4;
+  } else if (profile == CLOCK_PROFILE_HSI_8MHZ) {
+    config->use_hse = 0;
+    config->pll_multiplier = 0;
+    config->ahb_divider = 1;
+    config->apb1_divider = 1;
+    config->apb2_divider = 1;
+    config->adc_divider = 2;
+  } else {
+    config->use_hse = 1;
+    config->pll_multiplier = 9;
+    config->ahb_divider = 1;
+    config->apb1_divider = 2;
+    config->apb2_divider = 1;
+    config->adc_divider = 6;
+  }
+}
+
+static uint32_t AhbDividerBits(int divider) {
+  if (divider <= 1) {
+    return RCC_CFGR_HPRE_DIV_NONE;
+  }
+  int index = 0;
+  while ((index < (AHB_DIVIDER_COUNT - 1)) &&
+         (g_ahb_dividers[index] < divider)) {
+    ++index;
+  }
+  return (8 | index) << RCC_CFGR_HPRE_SHIFT;
+}
+
+// Returns the field value for an APB divider, before shifting.
+static uint32_t ApbDividerField(int divider) {
+  if (divider <= 1) {
+    return 0;
+  }
+  int index = 0;
+  while ((index < (APB_DIVIDER_COUNT - 1)) && ((2 << index) < divider)) {
+    ++index;
+  }
+  return 4 | index;
+}
+
+static uint32_t AdcDividerBits(int divider) {
+  int index = (divider - 1) / 2;
+  if (index < 0) {
+    index = 0;
+  } else if (index > 3) {
+    index = 3;
+  }
+  return index << RCC_CFGR_ADCPRE_SHIFT;
+}
+
+static uint32_t PllInputRate(uint32_t cfgr) {
+  if (!(cfgr & RCC_CFGR_PLLSRC_HSE)) {
+    return CLOCK_HSI_RATE / 2;
+  }
+  if (cfgr & RCC_CFGR_PLLXTPRE) {
+    return CLOCK_HSE_RATE / 2;
+  }
+  return CLOCK_HSE_RATE;
+}
+
+static int PllMultiplier(uint32_t cfgr) {
+  const int multiplier =
+      ((cfgr & RCC_CFGR_PLLMUL_MASK) >> RCC_CFGR_PLLMUL_SHIFT) + 2;
+  return (multiplier > 16) ? 16 : multiplier;
+}
+
+// Up to 24MHz flash needs no wait states, up to 48MHz one, and above that
+// two.
+static uint32_t FlashLatencyForRate(uint32_t rate) {
+  if (rate <= (24 * 1000 * 1000)) {
+    return FLASH_ACR_LATENCY_0;
+  } else if (rate <= (48 * 1000 * 1000)) {
+    return FLASH_ACR_LATENCY_1;
+  }
+  return FLASH_ACR_LATENCY_2;
+}
+
+static void SetFlashLatency(uint32_t latency) {
+  *FLASH_ACR = FLASH_ACR_PRFTBE | latency;
+}
+
+static void SwitchSystemClock(uint32_t source, uint32_t status) {
+  RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW_MASK) | source;
+  while ((RCC->CFGR & RCC_CFGR_SWS_MASK) != status) {
+  }
+}
+
+void ClockInit(const ClockConfig* config) {
+  uint32_t oscillator_rate;
+  if (config->use_hse) {
+    oscillator_rate = CLOCK_HSE_RATE;
+  } else {
+    oscillator_rate = CLOCK_HSI_RATE;
+  }
+  uint32_t system_rate;
+  if (config->pll_multiplier > 0) {
+    const uint32_t pll_input_rate =
+        config->use_hse ? CLOCK_HSE_RATE : (CLOCK_HSI_RATE / 2);
+    system_rate = pll_input_rate * config->pll_multiplier;
+  } else {
+    system_rate = oscillator_rate;
+  }
+  const uint32_t new_latency = FlashLatencyForRate(system_rate);
+
+  // Run from the internal oscillator while everything else changes, since
+  // the PLL can't be reconfigured while it's in use. Its 8MHz is safe with
+  // any number of flash wait states, so keep whichever is larger of the old
+  // and new settings until we've switched over.
+  RCC->CR |= RCC_CR_HSION;
+  while (!(RCC->CR & RCC_CR_HSIRDY)) {
+  }
+  const uint32_t old_latency = *FLASH_ACR & FLASH_ACR_LATENCY_MASK;
+  if (new_latency > old_latency) {
+    SetFlashLatency(new_latency);
+  }
+  SwitchSystemClock(RCC_CFGR_SW_HSI, RCC_CFGR_SWS_HSI);
+  RCC->CR &= ~RCC_CR_PLLON;
+  while (RCC->CR & RCC_CR_PLLRDY) {
+  }
+
+  if (config->use_hse) {
+    RCC->CR |= RCC_CR_HSEON;
+    while (!(RCC->CR & RCC_CR_HSERDY)) {
+    }
+  }
+
+  uint32_t cfgr = RCC_CFGR_SW_HSI | AhbDividerBits(config->ahb_divider) |
+                  (ApbDividerField(config->apb1_divider)
+                   << RCC_CFGR_PPRE1_SHIFT) |
+                  (ApbDividerField(config->apb2_divider)
+                   << RCC_CFGR_PPRE2_SHIFT) |
+                  AdcDividerBits(config->adc_divider);
+  if (config->pll_multiplier > 0) {
+    int multiplier = config->pll_multiplier;
+    if (multiplier < 2) {
+      multiplier = 2;
+    } else if (multiplier > 16) {
+      multiplier = 16;
+    }
+    cfgr |= (multiplier - 2) << RCC_CFGR_PLLMUL_SHIFT;
+    if (config->use_hse) {
+      cfgr |= RCC_CFGR_PLLSRC_HSE;
+    }
+    // USB needs 48MHz, which the PLL provides either directly or divided by
+    // 1.5 from 72MHz.
+    if (system_rate == (48 * 1000 * 1000)) {
+      cfgr |= RCC_CFGR_USBPRE;
+    }
+  }
+  RCC->CFGR = cfgr;
+
+  if (config->pll_multiplier > 0) {
+    RCC->CR |= RCC_CR_PLLON;
+    while (!(RCC->CR & RCC_CR_PLLRDY)) {
+    }
+    SwitchSystemClock(RCC_CFGR_SW_PLL, RCC_CFGR_SWS_PLL);
+  } else if (config->use_hse) {
+    SwitchSystemClock(RCC_CFGR_SW_HSE, RCC_CFGR_SWS_HSE);
+  }
+  SetFlashLatency(new_latency);
+
+  if (!config->use_hse) {
+    RCC->CR &= ~RCC_CR_HSEON;
+  }
+}
+
+uint32_t ClockGetSystemRate(void) {
+  const uint32_t cfgr = RCC->CFGR;
+  const uint32_t status = cfgr & RCC_CFGR_SWS_MASK;
+  if (status == RCC_CFGR_SWS_HSE) {
+    return CLOCK_HSE_RATE;
+  } else if (status == RCC_CFGR_SWS_PLL) {
+    return PllInputRate(cfgr) * PllMultiplier(cfgr);
+  }
+  return CLOCK_HSI_RATE;
+}
+
+uint32_t ClockGetHclkRate(void) {
+  const uint32_t field =
+      (RCC->CFGR & RCC_CFGR_HPRE_MASK) >> RCC_CFGR_HPRE_SHIFT;
+  const uint32_t system_rate = ClockGetSystemRate();
+  if (field < 8) {
+    return system_rate;
+  }
+  return system_rate / g_ahb_dividers[field - 8];
+}
+
+// Converts an APB prescaler field into the rate it produces.
+static uint32_t ApbRate(uint32_t field) {
+  const uint32_t hclk_rate = ClockGetHclkRate();
+  if (field < 4) {
+    return hclk_rate;
+  }
+  return hclk_rate >> (field - 3);
+}
+
+uint32_t ClockGetPclk1Rate(void) {
+  return ApbRate((RCC->CFGR & RCC_CFGR_PPRE1_MASK) >> RCC_CFGR_PPRE1_SHIFT);
+}
+
+uint32_t ClockGetPclk2Rate(void) {
+  return ApbRate((RCC->CFGR & RCC_CFGR_PPRE2_MASK) >> RCC_CFGR_PPRE2_SHIFT);
+}
+
+uint32_t ClockGetAdcRate(void) {
+  const uint32_t field =
+      (RCC->CFGR & RCC_CFGR_ADCPRE_MASK) >> RCC_CFGR_ADCPRE_SHIFT;
+  return ClockGetPclk2Rate() / ((field + 1) * 2);
+}
@@ -0,0 +1,82 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "delay.h"
+
+#include "clocks.h"
+#include "power.h"
+
+// The longest single wait on the cycle counter, leaving plenty of margin
+// before its differences become ambiguous.
+#define MAX_CHUNK_CYCLES (0x80000000)
+
+// Spins until cycles have passed since start, for waits of any length. The
+// start is read by the callers before they do any calculations, so the time
+// those take counts as part of the delay.
+static void DelayLongCycles(uint32_t start, uint64_t cycles) {
+  while (cycles > MAX_CHUNK_CYCLES) {
+    DelayUntilCycles(start, MAX_CHUNK_CYCLES);
+    start += MAX_CHUNK_CYCLES;
+    cycles -= MAX_CHUNK_CYCLES;
+  }
+  DelayUntilCycles(start, (uint32_t)(cycles));
+}
+
+void DelayMicroseconds(uint32_t us) {
+  DelayEnableCycleCounter();
+  const uint32_t start = DWT->CYCCNT;
+  // HCLK is always a whole number of megahertz.
+  const uint32_t cycles_per_us = ClockGetHclkRate() / 1000000;
+  DelayLongCycles(start, (uint64_t)(us)*cycles_per_us);
+}
+
+void DelayMilliseconds(uint32_t ms) {
+  DelayEnableCycleCounter();
+  const uint32_t start = DWT->CYCCNT;
+  const uint32_t cycles_per_ms = ClockGetHclkRate() / 1000;
+  DelayLongCycles(start, (uint64_t)(ms)*cycles_per_ms);
+}
+
+void DelaySleepMilliseconds(uint32_t ms) {
+  DelayEnableCycleCounter();
+  uint32_t last = DWT->CYCCNT;
+  const uint32_t cycles_per_ms = ClockGetHclkRate() / 1000;
+  const uint64_t cycles = (uint64_t)(ms)*cycles_per_ms;
+
+  const uint32_t tick_flags =
+      SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk;
+  const int is_tick_running = ((SysTick->CTRL & tick_flags) == tick_flags);
+  if (!is_tick_running) {
+    SysTick_Config(cycles_per_ms);
+  }
+  // SysTick counts either processor cycles, or cycles divided by eight.
+  uint32_t tick_cycles = SysTick->LOAD + 1;
+  if (!(SysTick->CTRL & SysTick_CTRL_CLKSOURCE_Msk)) {
+    tick_cycles *= 8;
+  }
+
+  // We wake at least once a tick, which is much less than the time it takes
+  // the cycle counter to wrap, so adding up the differences is safe.
+  uint64_t elapsed = 0;
+  while ((elapsed + tick_cycles) < cycles) {
+    PowerSleep();
+    const uint32_t now = DWT->CYCCNT;
+    elapsed += now - last;
+    last = now;
+  }
+  if (!is_tick_running) {
+    SysTick->CTRL = 0;
+  }
+  if (elapsed < cycles) {
+    DelayLongCycles(last, cycles - elapsed);
+  }
+}
@@ -0,0 +1,334 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "dma.h"
+
+#include "atomic.h"
+#include "vector_table.h"
+
+// Returns the index the DMA channel will write its next value to.
+static inline int GetWriteIndex(const DmaRingReader* reader) {
+  // CNDTR counts down from the buffer size as each value is written, and is
+  // reloaded as soon as it reaches zero, but in case we catch it in between
+  // treat zero as the start of the next lap.
+  const int index = reader->buffer_count - reader->channel->CNDTR;
+  if ((index < 0) || (index >= reader->buffer_count)) {
+    return 0;
+  }
+  return index;
+}
+
+// Clears the channel's flags and starts reading from the current position.
+static void StartReading(DmaRingReader* reader) {
+  DMA1->IFCR = reader->half_transfer_flag | reader->transfer_complete_flag;
+  reader->write_index = GetWriteIndex(reader);
+  reader->read_index = reader->write_index;
+  reader->pending_flags = 0;
+}
+
+void DmaRingReaderInit(DmaRingReader* reader, int channel,
+                       const uint16_t* buffer, int buffer_count) {
+  reader->channel = DmaChannelToStruct(DMA1, channel);
+  // The flags are at the same bit positions in both ISR and IFCR.
+  reader->half_transfer_flag = DmaChannelFlag(channel, DMA_ISR_HTIF1);
+  reader->transfer_complete_flag = DmaChannelFlag(channel, DMA_ISR_TCIF1);
+  reader->buffer = buffer;
+  reader->buffer_count = buffer_count;
+  reader->written_count = 0;
+  reader->read_count = 0;
+  reader->overrun_count = 0;
+  StartReading(reader);
+}
+
+void DmaRingReaderSkip(DmaRingReader* reader) {
+  StartReading(reader);
+  reader->read_count = reader->written_count;
+}
+
+// Returns how many more values the DMA has to write from index before it
+// reaches boundary and sets that boundary's flag. If it's already there, the
+// flag has been set, so the next one is a whole lap away.
+static inline int DistanceTo(int index, int boundary, int buffer_count) {
+  int distance = boundary - index;
+  if (distance <= 0) {
+    distance += buffer_count;
+  }
+  return distance;
+}
+
+// Catches up with the DMA position, and skips ahead if we've been overrun.
+static void UpdateWritePosition(DmaRingReader* reader) {
+  const uint32_t half_flag = reader->half_transfer_flag;
+  const uint32_t complete_flag = reader->transfer_complete_flag;
+  const uint32_t set_flags = DMA1->ISR & (half_flag | complete_flag);
+  if (set_flags) {
+    DMA1->IFCR = set_flags;
+  }
+  // Read the position after clearing the flags, so any boundary we see it
+  // pass here that happened after the clear will show up as a flag next
+  // time.
+  const int buffer_count = reader->buffer_count;
+  const int write_index = GetWriteIndex(reader);
+  const int previous_index = reader->write_index;
+  int new_count = write_index - previous_index;
+  if (new_count < 0) {
+    new_count += buffer_count;
+  }
+
+  // Work out which boundaries the position says we've passed, and check
+  // the flags against them. A flag that was set without its boundary being
+  // passed this time, or just after the last update, means the DMA has been
+  // all the way round since we last looked.
+  uint32_t passed_flags = 0;
+  if (DistanceTo(previous_index, buffer_count / 2, buffer_count) <=
+      new_count) {
+    passed_flags |= half_flag;
+  }
+  if (DistanceTo(previous_index, buffer_count, buffer_count) <= new_count) {
+    passed_flags |= complete_flag;
+  }
+  const uint32_t unexplained_flags =
+      set_flags & ~(passed_flags | reader->pending_flags);
+  if (unexplained_flags) {
+    new_count += buffer_count;
+  }
+  reader->pending_flags =
+      (reader->pending_flags | passed_flags) & ~set_flags;
+
+  reader->write_index = write_index;
+  reader->written_count += new_count;
+
+  // Once we're a whole buffer behind, the DMA is overwriting the oldest
+  // values we haven't read, so skip forward to the newest.
+  const uint32_t unread_count = reader->written_count - reader->read_count;
+  if (unread_count >= (uint32_t)(buffer_count)) {
+    ++reader->overrun_count;
+    reader->read_count = reader->written_count;
+    reader->read_index = write_index;
+  }
+}
+
+int DmaRingReaderAvailable(DmaRingReader* reader) {
+  UpdateWritePosition(reader);
+  return reader->written_count - reader->read_count;
+}
+
+int DmaRingReaderPeek(DmaRingReader* reader, const uint16_t** data) {
+  const int available = DmaRingReaderAvailable(reader);
+  const int contiguous = reader->buffer_count - reader->read_index;
+  *data = reader->buffer + reader->read_index;
+  if (available < contiguous) {
+    return available;
+  }
+  return contiguous;
+}
+
+void DmaRingReaderConsume(DmaRingReader* reader, int count) {
+  reader->read_index += count;
+  if (reader->read_index >= reader->buffer_count) {
+    reader->read_index -= reader->buffer_count;
+  }
+  reader->read_count += count;
+}
+
+int DmaRingReaderRead(DmaRingReader* reader, uint16_t* output,
+                      int max_count) {
+  int copied_count = 0;
+  // At most two passes are needed, one up to the end of the buffer and one
+  // from the start.
+  for (int pass = 0; (pass < 2) && (copied_count < max_count); ++pass) {
+    const uint16_t* data;
+    int count = DmaRingReaderPeek(reader, &data);
+    if (count > (max_count - copied_count)) {
+      count = max_count - copied_count;
+    }
+    for (int i = 0; i < count; ++i) {
+      output[copied_count + i] = data[i];
+    }
+    DmaRingReaderConsume(reader, count);
+    copied_count += count;
+  }
+  return copied_count;
+}
+
+// What we need to remember about each channel's memory-to-memory transfer.
+typedef struct {
+  OnDmaCompleteCallback callback;
+  void* arg;
+  volatile int is_busy;
+  volatile int has_error;
+  // The source for fills, so callers don't have to keep the value around.
+  uint32_t fill_value;
+} DmaTransferState;
+
+// Indexed by channel number, so entry zero is unused.
+static DmaTransferState g_transfer_states[DMA_CHANNEL_COUNT + 1];
+// A bit for each channel that's been claimed.
+static volatile uint32_t g_claimed_channels = 0;
+
+static void OnChannel2Interrupt(void) { DmaHandleInterrupt(2); }
+static void OnChannel3Interrupt(void) { DmaHandleInterrupt(3); }
+static void OnChannel4Interrupt(void) { DmaHandleInterrupt(4); }
+static void OnChannel5Interrupt(void) { DmaHandleInterrupt(5); }
+static void OnChannel6Interrupt(void) { DmaHandleInterrupt(6); }
+static void OnChannel7Interrupt(void) { DmaHandleInterrupt(7); }
+
+// Indexed by channel number. Channel 1 is left to the application, since
+// it's the ADC's channel.
+static const VectorHandler g_channel_handlers[DMA_CHANNEL_COUNT + 1] = {
+    0,
+    0,
+    OnChannel2Interrupt,
+    OnChannel3Interrupt,
+    OnChannel4Interrupt,
+    OnChannel5Interrupt,
+    OnChannel6Interrupt,
+    OnChannel7Interrupt,
+};
+
+int DmaClaimChannel(void) {
+  RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+  for (int channel = DMA_FIRST_MEM2MEM_CHANNEL; channel <= DMA_CHANNEL_COUNT;
+       ++channel) {
+    const uint32_t bit = (1 << channel);
+    while (1) {
+      const uint32_t claimed = g_claimed_channels;
+      if (claimed & bit) {
+        break;
+      }
+      if (AtomicCompareAndSwap(&g_claimed_channels, claimed, claimed | bit)) {
+        // Install the handler now, rather than defining the channel's
+        // handler at link time, so programs that don't use these transfers
+        // are still free to define their own.
+        VectorTableSetHandler(DMA1_Channel1_IRQn + (channel - 1),
+                              g_channel_handlers[channel]);
+        return channel;
+      }
+      // Someone else claimed a channel in the meantime, so check again.
+    }
+  }
+  return 0;
+}
+
+void DmaReleaseChannel(int channel) {
+  uint32_t claimed;
+  do {
+    claimed = g_claimed_channels;
+  } while (!AtomicCompareAndSwap(&g_claimed_channels, claimed,
+                                 claimed & ~(1 << channel)));
+}
+
+static void FinishTransfer(int channel, int has_error) {
+  DMA_Channel_t* registers = DmaChannelToStruct(DMA1, channel);
+  registers->CCR &= ~DMA_CCR_EN;
+  DMA1->IFCR = DmaChannelFlag(channel, DMA_IFCR_CGIF1);
+  DmaTransferState* state = &g_transfer_states[channel];
+  state->has_error = has_error;
+  state->is_busy = 0;
+  if (state->callback) {
+    state->callback(channel, has_error, state->arg);
+  }
+}
+
+static int StartTransfer(int channel, void* dest, const void* source,
+                         int count, int width, int increment_source,
+                         OnDmaCompleteCallback callback, void* arg) {
+  if ((count <= 0) || (count > DMA_MAX_TRANSFER_COUNT) ||
+      DmaIsBusy(channel)) {
+    return 0;
+  }
+  uint32_t sizes;
+  if (width == DMA_WIDTH_8) {
+    sizes = DMA_CCR_PSIZE_8 | DMA_CCR_MSIZE_8;
+  } else if (width == DMA_WIDTH_16) {
+    sizes = DMA_CCR_PSIZE_16 | DMA_CCR_MSIZE_16;
+  } else {
+    sizes = DMA_CCR_PSIZE_32 | DMA_CCR_MSIZE_32;
+  }
+
+  DmaTransferState* state = &g_transfer_states[channel];
+  state->callback = callback;
+  state->arg = arg;
+  state->has_error = 0;
+  state->is_busy = 1;
+
+  DMA_Channel_t* registers = DmaChannelToStruct(DMA1, channel);
+  registers->CCR = 0;
+  DMA1->IFCR = DmaChannelFlag(channel, DMA_IFCR_CGIF1);
+  // In memory-to-memory mode, the "peripheral" address is the source.
+  registers->CPAR = (uint32_t)(source);
+  registers->CMAR = (uint32_t)(dest);
+  registers->CNDTR = count;
+  uint32_t ccr = DMA_CCR_MEM2MEM | DMA_CCR_DIR_FROM_PERIPHERAL | DMA_CCR_MINC |
+                 DMA_CCR_PL_LOW | sizes;
+  if (increment_source) {
+    ccr |= DMA_CCR_PINC;
+  }
+  if (callback) {
+    ccr |= DMA_CCR_TCIE | DMA_CCR_TEIE;
+    NVIC_EnableIRQ(DMA1_Channel1_IRQn + (channel - 1));
+  }
+  registers->CCR = ccr;
+  registers->CCR = ccr | DMA_CCR_EN;
+  return 1;
+}
+
+int DmaCopyStart(int channel, void* dest, const void* source, int count,
+                 int width, OnDmaCompleteCallback callback, void* arg) {
+  return StartTransfer(channel, dest, source, count, width, 1, callback, arg);
+}
+
+int DmaFillStart(int channel, void* dest, uint32_t value, int count,
+                 int width, OnDmaCompleteCallback callback, void* arg) {
+  if (DmaIsBusy(channel)) {
+    return 0;
+  }
+  // Narrower widths read the bottom bytes of the word, since we're
+  // little-endian.
+  DmaTransferState* state = &g_transfer_states[channel];
+  state->fill_value = value;
+  return StartTransfer(channel, dest, &state->fill_value, count, width, 0,
+                       callback, arg);
+}
+
+int DmaIsBusy(int channel) {
+  DmaTransferState* state = &g_transfer_states[channel];
+  if (!state->is_busy) {
+    return 0;
+  }
+  // Transfers with callbacks are finished off by the interrupt handler, but
+  // we have to check the flags ourselves for the others.
+  if (!state->callback) {
+    const uint32_t status = DMA1->ISR;
+    if (status & DmaChannelFlag(channel, DMA_ISR_TEIF1)) {
+      FinishTransfer(channel, 1);
+    } else if (status & DmaChannelFlag(channel, DMA_ISR_TCIF1)) {
+      FinishTransfer(channel, 0);
+    }
+  }
+  return state->is_busy;
+}
+
+int DmaWait(int channel) {
+  while (DmaIsBusy(channel)) {
+  }
+  return g_transfer_states[channel].has_error;
+}
+
+void DmaHandleInterrupt(int channel) {
+  const uint32_t status = DMA1->ISR;
+  if (status & DmaChannelFlag(channel, DMA_ISR_TEIF1)) {
+    FinishTransfer(channel, 1);
+  } else if (status & DmaChannelFlag(channel, DMA_ISR_TCIF1)) {
+    FinishTransfer(channel, 0);
+  }
+}
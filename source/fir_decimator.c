@@ -0,0 +1,165 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "fir_decimator.h"
+
+// Converts a raw 12-bit ADC sample into a signed Q15 value.
+static inline int32_t AdcToQ15(uint16_t value) {
+  return ((int32_t)(value)-FIR_DECIMATOR_ADC_OFFSET) << 4;
+}
+
+// Rounds a Q30 accumulator down to Q15, clamping to the int16_t range.
+static inline int16_t RoundQ30ToQ15(int32_t total) {
+  const int32_t result = (total + (1 << 14)) >> 15;
+  if (result > INT16_MAX) {
+    return INT16_MAX;
+  } else if (result < INT16_MIN) {
+    return INT16_MIN;
+  }
+  return result;
+}
+
+void FirDecimatorInit(FirDecimator* decimator, const int16_t* taps,
+                      int tap_count, int factor, int16_t* history) {
+  decimator->taps = taps;
+  decimator->tap_count = tap_count;
+  decimator->factor = factor;
+  decimator->history = history;
+  int32_t tap_sum = 0;
+  for (int i = 0; i < tap_count; ++i) {
+    tap_sum += taps[i];
+  }
+  decimator->tap_sum = tap_sum;
+  FirDecimatorReset(decimator);
+}
+
+void FirDecimatorReset(FirDecimator* decimator) {
+  const int history_count = decimator->tap_count - 1;
+  for (int i = 0; i < history_count; ++i) {
+    decimator->history[i] = 0;
+  }
+  decimator->phase = 0;
+}
+
+// Adds up the part of an output's filter window that lies before the start
+// of the current block, and so has to be read from the history.
+static inline int32_t AccumulateHistory(const FirDecimator* decimator,
+                                        int index) {
+  const int16_t* taps = decimator->taps;
+  const int tap_count = decimator->tap_count;
+  // A sample at block position -1 is the last history entry.
+  const int16_t* history = decimator->history + (tap_count - 1) + index;
+  int32_t total = 0;
+  for (int k = index + 1; k < tap_count; ++k) {
+    total += taps[k] * history[-k];
+  }
+  return total;
+}
+
+// Slides the newest samples from the block into the history, so the first
+// outputs of the next block can see them.
+static void UpdateHistory(FirDecimator* decimator, const int16_t* input,
+                          const uint16_t* adc_input, int input_count) {
+  int16_t* history = decimator->history;
+  const int history_count = decimator->tap_count - 1;
+  int keep_count = history_count - input_count;
+  if (keep_count < 0) {
+    keep_count = 0;
+  }
+  for (int i = 0; i < keep_count; ++i) {
+    history[i] = history[i + input_count];
+  }
+  const int first = input_count - (history_count - keep_count);
+  for (int i = keep_count; i < history_count; ++i) {
+    const int source = first + (i - keep_count);
+    if (adc_input) {
+      history[i] = AdcToQ15(adc_input[source]);
+    } else {
+      history[i] = input[source];
+    }
+  }
+}
+
+int FirDecimatorProcess(FirDecimator* decimator, const int16_t* input,
+                        int input_count, int16_t* output) {
+  const int16_t* taps = decimator->taps;
+  const int tap_count = decimator->tap_count;
+  const int factor = decimator->factor;
+  int16_t* const output_start = output;
+  int n = decimator->phase;
+
+  // The first few outputs need samples from the previous block too.
+  for (; (n < input_count) && (n < (tap_count - 1)); n += factor) {
+    int32_t total = AccumulateHistory(decimator, n);
+    for (int k = 0; k <= n; ++k) {
+      total += taps[k] * input[n - k];
+    }
+    *output++ = RoundQ30ToQ15(total);
+  }
+
+  // After that, the whole window lies inside the block, so we can read it
+  // straight from the DMA buffer.
+  for (; n < input_count; n += factor) {
+    const int16_t* sample = input + n;
+    int32_t total = 0;
+    for (int k = 0; k < tap_count; ++k) {
+      total += taps[k] * sample[-k];
+    }
+    *output++ = RoundQ30ToQ15(total);
+  }
+
+  decimator->phase = n - input_count;
+  UpdateHistory(decimator, input, 0, input_count);
+  return output - output_start;
+}
+
+int FirDecimatorProcessAdc(FirDecimator* decimator, const uint16_t* input,
+                           int input_count, int16_t* output) {
+  const int16_t* taps = decimator->taps;
+  const int tap_count = decimator->tap_count;
+  const int factor = decimator->factor;
+  int16_t* const output_start = output;
+  int n = decimator->phase;
+
+  for (; (n < input_count) && (n < (tap_count - 1)); n += factor) {
+    int32_t total = AccumulateHistory(decimator, n);
+    for (int k = 0; k <= n; ++k) {
+      total += taps[k] * AdcToQ15(input[n - k]);
+    }
+    *output++ = RoundQ30ToQ15(total);
+  }
+
+  // For the main part of the block we multiply the raw samples directly, and
+  // correct for the offset afterwards using the sum of the taps:
+  // sum(h * (x - offset) * 16) = (sum(h * x) - (offset * sum(h))) * 16.
+  // Rounding to Q15 is a shift down by 15, so overall it's a shift by 11.
+  const int32_t offset_total = FIR_DECIMATOR_ADC_OFFSET * decimator->tap_sum;
+  for (; n < input_count; n += factor) {
+    const uint16_t* sample = input + n;
+    int32_t total = 0;
+    for (int k = 0; k < tap_count; ++k) {
+      total += taps[k] * sample[-k];
+    }
+    const int32_t result = ((total - offset_total) + (1 << 10)) >> 11;
+    if (result > INT16_MAX) {
+      *output++ = INT16_MAX;
+    } else if (result < INT16_MIN) {
+      *output++ = INT16_MIN;
+    } else {
+      *output++ = result;
+    }
+  }
+
+  decimator->phase = n - input_count;
+  UpdateHistory(decimator, 0, input, input_count);
+  return output - output_start;
+}
@@ -0,0 +1,113 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "goertzel.h"
+
+// The mid-point of the 12-bit unsigned values the ADC produces, used as the
+// first guess at the DC level.
+#define ADC_OFFSET (2048)
+
+// Calculates cos(2 * pi * fraction) for a fraction between 0 and 0.5, without
+// needing the math library. This is only used during initialization, so
+// speed isn't important, but the result needs to be accurate to better than
+// the Q14 coefficients it's used for.
+static float CosineOfFraction(float fraction) {
+  const float pi = 3.14159265358979f;
+  // Fold the angle into the range 0 to pi/2, where the Taylor series below
+  // converges quickly, using cos(pi - x) = -cos(x).
+  float sign = 1.0f;
+  if (fraction > 0.25f) {
+    fraction = 0.5f - fraction;
+    sign = -1.0f;
+  }
+  const float x = 2.0f * pi * fraction;
+  const float x2 = x * x;
+  // The terms up to x^10 leave an error below 1e-6 over this range.
+  float term = 1.0f;
+  float total = 1.0f;
+  for (int i = 1; i <= 5; ++i) {
+    term *= -x2 / ((2 * i - 1) * (2 * i));
+    total += term;
+  }
+  return sign * total;
+}
+
+void GoertzelBankInit(GoertzelBank* bank, const int32_t* frequencies,
+                      int tone_count, int32_t sample_rate, int32_t threshold,
+                      OnGoertzelToneCallback callback) {
+  if (tone_count > GOERTZEL_MAX_TONES) {
+    tone_count = GOERTZEL_MAX_TONES;
+  }
+  bank->tone_count = tone_count;
+  for (int i = 0; i < tone_count; ++i) {
+    const float fraction = (float)(frequencies[i]) / (float)(sample_rate);
+    const float coefficient = 2.0f * CosineOfFraction(fraction);
+    bank->coefficients[i] = (int32_t)((coefficient * (1 << 14)) + 0.5f);
+    bank->levels[i] = 0;
+  }
+  bank->threshold = threshold;
+  bank->dc_offset = ADC_OFFSET;
+  bank->callback = callback;
+}
+
+uint32_t GoertzelBankProcessAdc(GoertzelBank* bank, const uint16_t* samples,
+                                int count) {
+  const int32_t dc_offset = bank->dc_offset;
+  const uint16_t* const end = samples + count;
+  const uint16_t* current;
+
+  // Measure the total energy of the block, which is what the tone energies
+  // are compared against, so the detection doesn't depend on the volume.
+  int32_t total = 0;
+  int64_t total_squared = 0;
+  for (current = samples; current != end; ++current) {
+    const int32_t value = *current - dc_offset;
+    total += value;
+    total_squared += value * value;
+  }
+  // Remove any DC that our offset estimate didn't catch from the energy, and
+  // move the estimate to this block's mean.
+  const int64_t energy = total_squared - (((int64_t)(total)*total) / count);
+  bank->dc_offset = dc_offset + (total / count);
+
+  uint32_t detected = 0;
+  for (int tone = 0; tone < bank->tone_count; ++tone) {
+    const int32_t coefficient = bank->coefficients[tone];
+    int32_t s1 = 0;
+    int32_t s2 = 0;
+    for (current = samples; current != end; ++current) {
+      const int32_t value = *current - dc_offset;
+      const int32_t s0 =
+          value + (int32_t)(((int64_t)(coefficient)*s1) >> 14) - s2;
+      s2 = s1;
+      s1 = s0;
+    }
+    // The squared magnitude of the DFT at the tone's frequency.
+    const int64_t power = ((int64_t)(s1)*s1) + ((int64_t)(s2)*s2) -
+                          ((((int64_t)(coefficient)*s1) >> 14) * s2);
+    // A sine wave with amplitude A has a power of (count * A / 2)^2, and an
+    // energy of count * A^2 / 2, so we scale by 2 / count to make a pure tone
+    // come out as 1.0.
+    int32_t level = 0;
+    if ((energy > 0) && (power > 0)) {
+      level = (int32_t)((power << 16) / (energy * count));
+    }
+    bank->levels[tone] = level;
+    if (level >= bank->threshold) {
+      detected |= (1 << tone);
+      if (bank->callback) {
+        bank->callback(tone, level);
+      }
+    }
+  }
+  return detected;
+}
@@ -0,0 +1,380 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "kernel.h"
+
+#include "power.h"
+#include "timers.h"
+
+#define TASK_STATE_READY (0)
+#define TASK_STATE_BLOCKED (1)
+#define TASK_STATE_SLEEPING (2)
+#define TASK_STATE_FINISHED (3)
+
+// Unused stack words hold this, so we can tell how much has been used.
+#define STACK_FILL_PATTERN (0xdeadbeef)
+
+// The initial program status register for a task, with just the Thumb bit.
+#define INITIAL_XPSR (0x01000000)
+
+// These are used by the context switch, so they can't be static.
+KernelTask* volatile g_kernel_current = 0;
+KernelTask* volatile g_kernel_next = 0;
+
+// Tasks by base priority.
+static KernelTask* g_tasks[KERNEL_PRIORITY_COUNT];
+// Ready tasks by the priority they're running at, which may be inherited.
+static KernelTask* g_ready_tasks[KERNEL_PRIORITY_COUNT];
+static volatile uint32_t g_ready = 0;
+// Sleeping tasks, by base priority.
+static volatile uint32_t g_sleeping = 0;
+static volatile uint32_t g_ticks = 0;
+static volatile int g_is_started = 0;
+
+static KernelTask g_idle_task;
+static uint32_t g_idle_stack[KERNEL_MIN_STACK_WORDS * 2];
+
+static inline uint32_t PriorityBit(int priority) {
+  return 0x80000000 >> priority;
+}
+
+// Returns the most urgent priority in a non-empty bitmap.
+static inline int HighestPriority(uint32_t bitmap) { return __CLZ(bitmap); }
+
+static void MakeReady(KernelTask* task) {
+  task->state = TASK_STATE_READY;
+  task->wait_list = 0;
+  g_ready_tasks[task->priority] = task;
+  g_ready |= PriorityBit(task->priority);
+}
+
+// Moves the current task from the ready set to a list of waiters.
+static void BlockCurrent(volatile uint32_t* wait_list, int state) {
+  KernelTask* task = g_kernel_current;
+  g_ready &= ~PriorityBit(task->priority);
+  task->state = state;
+  task->wait_list = wait_list;
+  *wait_list |= PriorityBit(task->base_priority);
+}
+
+// Takes the most urgent task off a non-empty list of waiters and makes it
+// ready.
+static KernelTask* WakeHighest(volatile uint32_t* wait_list) {
+  const int priority = HighestPriority(*wait_list);
+  *wait_list &= ~PriorityBit(priority);
+  KernelTask* task = g_tasks[priority];
+  MakeReady(task);
+  return task;
+}
+
+// Switches to the most urgent ready task, once all handlers have finished.
+// This must be called with interrupts disabled.
+static void Schedule(void) {
+  if (!g_is_started) {
+    return;
+  }
+  KernelTask* next = g_ready_tasks[HighestPriority(g_ready)];
+  if (next != g_kernel_current) {
+    g_kernel_next = next;
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+  }
+}
+
+static void SetPriority(KernelTask* task, int priority) {
+  if (priority == task->priority) {
+    return;
+  }
+  if (task->state == TASK_STATE_READY) {
+    g_ready &= ~PriorityBit(task->priority);
+    // If we're leaving an inherited priority, its rightful owner is blocked,
+    // so its slot doesn't need restoring.
+    task->priority = priority;
+    MakeReady(task);
+  } else {
+    // Blocked tasks are filed by base priority, so nothing else changes.
+    task->priority = priority;
+  }
+}
+
+// Works out a task's priority from its base and the waiters on the mutexes
+// it holds.
+static int InheritedPriority(const KernelTask* task) {
+  uint32_t waiting = PriorityBit(task->base_priority);
+  for (const KernelMutex* mutex = task->held_mutexes; mutex != 0;
+       mutex = mutex->next_held) {
+    waiting |= mutex->waiting;
+  }
+  return HighestPriority(waiting);
+}
+
+// Tasks that return end up here.
+static void TaskExit(void) {
+  __disable_irq();
+  KernelTask* task = g_kernel_current;
+  g_ready &= ~PriorityBit(task->priority);
+  task->state = TASK_STATE_FINISHED;
+  Schedule();
+  __enable_irq();
+  // PendSV switches away as soon as interrupts are enabled.
+  while (1) {
+  }
+}
+
+static void IdleTask(void* arg) {
+  while (1) {
+    PowerSleep();
+  }
+}
+
+// Called from SysTick to wake any sleepers that are due.
+static void OnTick(int tick_count) {
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  ++g_ticks;
+  uint32_t sleeping = g_sleeping;
+  while (sleeping) {
+    const int priority = HighestPriority(sleeping);
+    const uint32_t bit = PriorityBit(priority);
+    sleeping &= ~bit;
+    KernelTask* task = g_tasks[priority];
+    if ((int32_t)(g_ticks - task->wake_tick) >= 0) {
+      g_sleeping &= ~bit;
+      MakeReady(task);
+    }
+  }
+  Schedule();
+  __set_PRIMASK(primask);
+}
+
+void KernelInit(void) {
+  for (int i = 0; i < KERNEL_PRIORITY_COUNT; ++i) {
+    g_tasks[i] = 0;
+    g_ready_tasks[i] = 0;
+  }
+  g_ready = 0;
+  g_sleeping = 0;
+  g_ticks = 0;
+  g_is_started = 0;
+  g_kernel_current = 0;
+  g_kernel_next = 0;
+  KernelCreateTask(&g_idle_task, KERNEL_IDLE_PRIORITY, IdleTask, 0,
+                   g_idle_stack, sizeof(g_idle_stack) / sizeof(uint32_t));
+}
+
+int KernelCreateTask(KernelTask* task, int priority,
+                     KernelTaskFunction function, void* arg, uint32_t* stack,
+                     int stack_words) {
+  if ((priority < 0) || (priority >= KERNEL_PRIORITY_COUNT) ||
+      (g_tasks[priority] != 0) || (stack_words < KERNEL_MIN_STACK_WORDS)) {
+    return 0;
+  }
+  for (int i = 0; i < stack_words; ++i) {
+    stack[i] = STACK_FILL_PATTERN;
+  }
+  task->stack = stack;
+  task->stack_words = stack_words;
+
+  // The stack has to be 8-byte aligned on exception entry and exit.
+  uint32_t* top =
+      (uint32_t*)((uint32_t)(stack + stack_words) & ~(uint32_t)(7));
+  // The frame the hardware pops on exception return, followed by r4-r11 for
+  // the context switch to pop, so the task starts as if it was switched
+  // out just before its first instruction.
+  *(--top) = INITIAL_XPSR;
+  // Function pointers have the bottom bit set to mark them as Thumb code,
+  // but the stacked PC has to be the real address, or the return is
+  // unpredictable. The LR is used with a BX, so it keeps the bit.
+  *(--top) = (uint32_t)(function) & ~(uint32_t)(1);
+  *(--top) = (uint32_t)(TaskExit);  // LR
+  *(--top) = 0;                     // R12
+  *(--top) = 0;                     // R3
+  *(--top) = 0;                     // R2
+  *(--top) = 0;                     // R1
+  *(--top) = (uint32_t)(arg);       // R0
+  for (int i = 0; i < 8; ++i) {
+    *(--top) = 0;  // R11 to R4.
+  }
+  task->stack_pointer = top;
+
+  task->base_priority = priority;
+  task->priority = priority;
+  task->held_mutexes = 0;
+  task->wake_tick = 0;
+
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  g_tasks[priority] = task;
+  MakeReady(task);
+  Schedule();
+  __set_PRIMASK(primask);
+  return 1;
+}
+
+void KernelStart(uint32_t tick_rate) {
+  __disable_irq();
+  // PendSV has to be the lowest priority, so it only switches once all the
+  // other handlers are done. SysTick_Config() makes SysTick the lowest too.
+  NVIC_SetPriority(PendSV_IRQn, (1 << __NVIC_PRIO_BITS) - 1);
+  g_tick_callback = OnTick;
+  SysTick_Config(ClockGetHclkRate() / tick_rate);
+  g_is_started = 1;
+  // With no current task, the first context switch doesn't save anything.
+  Schedule();
+  __enable_irq();
+  while (1) {
+  }
+}
+
+KernelTask* KernelCurrentTask(void) { return g_kernel_current; }
+
+uint32_t KernelGetTicks(void) { return g_ticks; }
+
+void KernelSleep(uint32_t ticks) {
+  if (ticks == 0) {
+    return;
+  }
+  __disable_irq();
+  g_kernel_current->wake_tick = g_ticks + ticks;
+  BlockCurrent(&g_sleeping, TASK_STATE_SLEEPING);
+  Schedule();
+  __enable_irq();
+}
+
+int KernelTaskStackUsed(const KernelTask* task) {
+  int unused = 0;
+  while ((unused < task->stack_words) &&
+         (task->stack[unused] == STACK_FILL_PATTERN)) {
+    ++unused;
+  }
+  return task->stack_words - unused;
+}
+
+void KernelSemaphoreInit(KernelSemaphore* semaphore, int32_t count) {
+  semaphore->count = count;
+  semaphore->waiting = 0;
+}
+
+void KernelSemaphoreTake(KernelSemaphore* semaphore) {
+  __disable_irq();
+  if (semaphore->count > 0) {
+    --semaphore->count;
+  } else {
+    // Whoever gives the semaphore hands it straight to us, so there's
+    // nothing to do once we've been woken.
+    BlockCurrent(&semaphore->waiting, TASK_STATE_BLOCKED);
+    Schedule();
+  }
+  __enable_irq();
+}
+
+int KernelSemaphoreTryTake(KernelSemaphore* semaphore) {
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const int is_available = (semaphore->count > 0);
+  if (is_available) {
+    --semaphore->count;
+  }
+  __set_PRIMASK(primask);
+  return is_available;
+}
+
+void KernelSemaphoreGive(KernelSemaphore* semaphore) {
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (semaphore->waiting) {
+    WakeHighest(&semaphore->waiting);
+    Schedule();
+  } else {
+    ++semaphore->count;
+  }
+  __set_PRIMASK(primask);
+}
+
+void KernelMutexInit(KernelMutex* mutex) {
+  mutex->owner = 0;
+  mutex->waiting = 0;
+  mutex->next_held = 0;
+}
+
+void KernelMutexLock(KernelMutex* mutex) {
+  __disable_irq();
+  KernelTask* task = g_kernel_current;
+  KernelTask* owner = mutex->owner;
+  if (owner == 0) {
+    mutex->owner = task;
+    mutex->next_held = task->held_mutexes;
+    task->held_mutexes = mutex;
+  } else {
+    // The unlock hands the mutex over to us before waking us.
+    BlockCurrent(&mutex->waiting, TASK_STATE_BLOCKED);
+    // Lend the owner our priority, so nothing less urgent than us can stop
+    // it getting to the unlock. This has to happen after we've left the
+    // ready set, since it takes over our slot there.
+    if (task->priority < owner->priority) {
+      SetPriority(owner, task->priority);
+    }
+    Schedule();
+  }
+  __enable_irq();
+}
+
+void KernelMutexUnlock(KernelMutex* mutex) {
+  __disable_irq();
+  KernelTask* task = g_kernel_current;
+  KernelMutex** link = &task->held_mutexes;
+  while (*link != mutex) {
+    link = &(*link)->next_held;
+  }
+  *link = mutex->next_held;
+  // Drop any priority we inherited through this mutex, before waking a
+  // waiter who may be using the same priority slot.
+  SetPriority(task, InheritedPriority(task));
+
+  if (mutex->waiting) {
+    KernelTask* next_owner = WakeHighest(&mutex->waiting);
+    mutex->owner = next_owner;
+    mutex->next_held = next_owner->held_mutexes;
+    next_owner->held_mutexes = mutex;
+    // Anyone still waiting is now waiting on the new owner.
+    SetPriority(next_owner, InheritedPriority(next_owner));
+  } else {
+    mutex->owner = 0;
+  }
+  Schedule();
+  __enable_irq();
+}
+
+__attribute__((naked)) void KernelPendSV(void) {
+  __asm volatile(
+      "cpsid i\n"
+      // Save the outgoing task's registers on its stack, unless this is the
+      // first switch and there's no outgoing task.
+      "ldr r1, =g_kernel_current\n"
+      "ldr r2, [r1]\n"
+      "cbz r2, 1f\n"
+      "mrs r0, psp\n"
+      "stmdb r0!, {r4-r11}\n"
+      "str r0, [r2]\n"
+      "1:\n"
+      // Restore the incoming task's.
+      "ldr r3, =g_kernel_next\n"
+      "ldr r2, [r3]\n"
+      "str r2, [r1]\n"
+      "ldr r0, [r2]\n"
+      "ldmia r0!, {r4-r11}\n"
+      "msr psp, r0\n"
+      // Return to thread mode, on the process stack.
+      "ldr lr, =0xfffffffd\n"
+      "cpsie i\n"
+      "bx lr\n"
+      ".ltorg\n");
+}
@@ -0,0 +1,133 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "perf_counters.h"
+
+#include "debug_log.h"
+
+// The DWT_CTRL enable bits for each of the PERF_COUNTER_* flags.
+static uint32_t EnableBits(uint32_t counters) {
+  uint32_t bits = 0;
+  if (counters & PERF_COUNTER_CYCLES) {
+    bits |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+  if (counters & PERF_COUNTER_CPI) {
+    bits |= DWT_CTRL_CPIEVTENA_Msk;
+  }
+  if (counters & PERF_COUNTER_EXCEPTION) {
+    bits |= DWT_CTRL_EXCEVTENA_Msk;
+  }
+  if (counters & PERF_COUNTER_SLEEP) {
+    bits |= DWT_CTRL_SLEEPEVTENA_Msk;
+  }
+  if (counters & PERF_COUNTER_LSU) {
+    bits |= DWT_CTRL_LSUEVTENA_Msk;
+  }
+  if (counters & PERF_COUNTER_FOLD) {
+    bits |= DWT_CTRL_FOLDEVTENA_Msk;
+  }
+  return bits;
+}
+
+int PerfCountersInit(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  return !(DWT->CTRL & DWT_CTRL_NOCYCCNT_Msk);
+}
+
+void PerfCountersStart(PerfCounterSession* session, uint32_t counters) {
+  session->counters = counters;
+  session->totals.cycles = 0;
+  session->totals.cpi_cycles = 0;
+  session->totals.exception_cycles = 0;
+  session->totals.sleep_cycles = 0;
+  session->totals.lsu_cycles = 0;
+  session->totals.folded_count = 0;
+  DWT->CTRL |= EnableBits(counters);
+  // Read the cycle counter last, so the other reads aren't included.
+  session->last_cpi = DWT->CPICNT;
+  session->last_exception = DWT->EXCCNT;
+  session->last_sleep = DWT->SLEEPCNT;
+  session->last_lsu = DWT->LSUCNT;
+  session->last_fold = DWT->FOLDCNT;
+  session->last_cycles = DWT->CYCCNT;
+}
+
+void PerfCountersUpdate(PerfCounterSession* session) {
+  // Read the cycle counter first, for the same reason as above.
+  const uint32_t cycles = DWT->CYCCNT;
+  const uint8_t cpi = DWT->CPICNT;
+  const uint8_t exception = DWT->EXCCNT;
+  const uint8_t sleep = DWT->SLEEPCNT;
+  const uint8_t lsu = DWT->LSUCNT;
+  const uint8_t fold = DWT->FOLDCNT;
+
+  // Unsigned subtraction gives the right answer across a wrap, as long as
+  // there's been no more than one since the last update.
+  const uint32_t counters = session->counters;
+  PerfCounts* totals = &session->totals;
+  if (counters & PERF_COUNTER_CYCLES) {
+    totals->cycles += (uint32_t)(cycles - session->last_cycles);
+  }
+  if (counters & PERF_COUNTER_CPI) {
+    totals->cpi_cycles += (uint8_t)(cpi - session->last_cpi);
+  }
+  if (counters & PERF_COUNTER_EXCEPTION) {
+    totals->exception_cycles += (uint8_t)(exception - session->last_exception);
+  }
+  if (counters & PERF_COUNTER_SLEEP) {
+    totals->sleep_cycles += (uint8_t)(sleep - session->last_sleep);
+  }
+  if (counters & PERF_COUNTER_LSU) {
+    totals->lsu_cycles += (uint8_t)(lsu - session->last_lsu);
+  }
+  if (counters & PERF_COUNTER_FOLD) {
+    totals->folded_count += (uint8_t)(fold - session->last_fold);
+  }
+  session->last_cycles = cycles;
+  session->last_cpi = cpi;
+  session->last_exception = exception;
+  session->last_sleep = sleep;
+  session->last_lsu = lsu;
+  session->last_fold = fold;
+}
+
+void PerfCountersStop(PerfCounterSession* session, PerfCounts* counts) {
+  PerfCountersUpdate(session);
+  *counts = session->totals;
+}
+
+void PerfCountsLog(char* label, const PerfCounts* counts) {
+  DebugLog(label);
+  DebugLog(": ");
+  DebugLogUInt32((uint32_t)(counts->cycles));
+  DebugLog(" cycles, ");
+  DebugLogUInt32(counts->cpi_cycles);
+  DebugLog(" CPI, ");
+  DebugLogUInt32(counts->lsu_cycles);
+  DebugLog(" LSU, ");
+  DebugLogUInt32(counts->exception_cycles);
+  DebugLog(" exception, ");
+  DebugLogUInt32(counts->sleep_cycles);
+  DebugLog(" sleep, ");
+  DebugLogUInt32(counts->folded_count);
+  DebugLog(" folded, ");
+  DebugLogUInt32((uint32_t)(PerfCountsInstructions(counts)));
+  DebugLog(" instructions, CPI ");
+  const uint32_t cpi = PerfCountsCpiHundredths(counts);
+  DebugLogUInt32(cpi / 100);
+  DebugLog(".");
+  if ((cpi % 100) < 10) {
+    DebugLog("0");
+  }
+  DebugLogUInt32(cpi % 100);
+  DebugLog("\n");
+}
@@ -0,0 +1,286 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "power.h"
+
+#include "clocks.h"
+
+static PowerResidency g_residency;
+// The cycle counter when time was last added to the residency counters.
+static uint32_t g_last_cycles;
+static uint32_t g_rtc_tick_rate = 0;
+
+// Adds the time since the last update to the awake total, and returns the
+// current cycle count.
+static uint32_t AccountAwakeTime(void) {
+  const uint32_t now = DWT->CYCCNT;
+  g_residency.awake_cycles += now - g_last_cycles;
+  g_last_cycles = now;
+  return now;
+}
+
+void PowerInit(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+  PowerResetResidency();
+}
+
+void PowerSleep(void) {
+  const uint32_t start = AccountAwakeTime();
+  __WFI();
+  const uint32_t end = DWT->CYCCNT;
+  g_residency.sleep_cycles += end - start;
+  ++g_residency.sleep_count;
+  g_last_cycles = end;
+}
+
+void PowerSleepUntilEvent(void) {
+  const uint32_t start = AccountAwakeTime();
+  __WFE();
+  const uint32_t end = DWT->CYCCNT;
+  g_residency.sleep_cycles += end - start;
+  ++g_residency.sleep_count;
+  g_last_cycles = end;
+}
+
+void PowerSetWakeOnPending(int enable) {
+  if (enable) {
+    SCB->SCR |= SCB_SCR_SEVONPEND_Msk;
+  } else {
+    SCB->SCR &= ~SCB_SCR_SEVONPEND_Msk;
+  }
+}
+
+void PowerSetSleepOnExit(int enable) {
+  if (enable) {
+    SCB->SCR |= SCB_SCR_SLEEPONEXIT_Msk;
+  } else {
+    SCB->SCR &= ~SCB_SCR_SLEEPONEXIT_Msk;
+  }
+}
+
+static int IsRtcRunning(void) {
+  return (g_rtc_tick_rate != 0) && (RCC->BDCR & RCC_BDCR_RTCEN);
+}
+
+// After a reset or Stop, the RTC registers can't be read until they've been
+// synchronized with the RTC's own clock again.
+static void RtcWaitForSync(void) {
+  RTC->CRL &= ~RTC_CRL_RSF;
+  while (!(RTC->CRL & RTC_CRL_RSF)) {
+  }
+}
+
+// Writes to the RTC take a few of its clock cycles to go through, and only
+// one can be in progress at a time.
+static void RtcWaitForWrite(void) {
+  while (!(RTC->CRL & RTC_CRL_RTOFF)) {
+  }
+}
+
+void PowerStop(int wait_for_event) {
+  const uint32_t saved_cr = RCC->CR;
+  const uint32_t saved_cfgr = RCC->CFGR;
+  const uint32_t saved_primask = __get_PRIMASK();
+  const int has_rtc = IsRtcRunning();
+  uint32_t rtc_start = 0;
+  if (has_rtc) {
+    rtc_start = PowerRtcGetCounter();
+  }
+
+  __disable_irq();
+  AccountAwakeTime();
+  RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+  PWR->CR = (PWR->CR & ~PWR_CR_PDDS) | PWR_CR_LPDS | PWR_CR_CWUF;
+  SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+  if (wait_for_event) {
+    // Clear out any stale event first, so the second WFE really waits.
+    __SEV();
+    __WFE();
+    __WFE();
+  } else {
+    __WFI();
+  }
+  SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+  // We wake up on the internal oscillator, so bring back the crystal and
+  // PLL if they were on, and then switch back to the old clock source. The
+  // flash wait states aren't affected by Stop.
+  if (saved_cr & RCC_CR_HSEON) {
+    RCC->CR |= RCC_CR_HSEON;
+    while (!(RCC->CR & RCC_CR_HSERDY)) {
+    }
+  }
+  if (saved_cr & RCC_CR_PLLON) {
+    RCC->CR |= RCC_CR_PLLON;
+    while (!(RCC->CR & RCC_CR_PLLRDY)) {
+    }
+  }
+  RCC->CFGR = saved_cfgr;
+  const uint32_t source_status = (saved_cfgr & RCC_CFGR_SW_MASK) << 2;
+  while ((RCC->CFGR & RCC_CFGR_SWS_MASK) != source_status) {
+  }
+
+  if (has_rtc) {
+    RtcWaitForSync();
+    const uint32_t stop_ticks = PowerRtcGetCounter() - rtc_start;
+    g_residency.stop_cycles +=
+        ((uint64_t)(stop_ticks)*ClockGetHclkRate()) / g_rtc_tick_rate;
+  }
+  ++g_residency.stop_count;
+  // The cycle counter doesn't run in Stop, so nothing else needs adding.
+  g_last_cycles = DWT->CYCCNT;
+  __set_PRIMASK(saved_primask);
+}
+
+uint32_t PowerRtcInit(int use_lse) {
+  // The RTC lives in the backup domain, which has to be unlocked before it
+  // can be changed.
+  RCC->APB1ENR |= RCC_APB1ENR_PWREN | RCC_APB1ENR_BKPEN;
+  PWR->CR |= PWR_CR_DBP;
+
+  uint32_t source;
+  if (use_lse) {
+    source = RCC_BDCR_RTCSEL_LSE;
+  } else {
+    source = RCC_BDCR_RTCSEL_LSI;
+  }
+  // The RTC's clock source can only be changed by resetting the whole
+  // backup domain.
+  if ((RCC->BDCR & RCC_BDCR_RTCSEL_MASK) != source) {
+    RCC->BDCR |= RCC_BDCR_BDRST;
+    RCC->BDCR &= ~RCC_BDCR_BDRST;
+  }
+
+  // Divide the oscillator down to roughly a millisecond per tick.
+  uint32_t prescale;
+  if (use_lse) {
+    RCC->BDCR |= RCC_BDCR_LSEON;
+    while (!(RCC->BDCR & RCC_BDCR_LSERDY)) {
+    }
+    prescale = 32;
+    g_rtc_tick_rate = 32768 / prescale;
+  } else {
+    RCC->CSR |= RCC_CSR_LSION;
+    while (!(RCC->CSR & RCC_CSR_LSIRDY)) {
+    }
+    prescale = 40;
+    g_rtc_tick_rate = 40000 / prescale;
+  }
+  RCC->BDCR |= source | RCC_BDCR_RTCEN;
+  RtcWaitForSync();
+
+  RtcWaitForWrite();
+  RTC->CRL |= RTC_CRL_CNF;
+  RTC->PRLH = (prescale - 1) >> 16;
+  RTC->PRLL = (prescale - 1) & 0xffff;
+  RTC->CNTH = 0;
+  RTC->CNTL = 0;
+  RTC->CRL &= ~RTC_CRL_CNF;
+  RtcWaitForWrite();
+  return g_rtc_tick_rate;
+}
+
+uint32_t PowerRtcGetTickRate(void) { return g_rtc_tick_rate; }
+
+uint32_t PowerRtcGetCounter(void) {
+  // The two halves are read separately, so try again if the top half
+  // changed in between.
+  uint32_t high;
+  uint32_t low;
+  do {
+    high = RTC->CNTH & 0xffff;
+    low = RTC->CNTL & 0xffff;
+  } while (high != (RTC->CNTH & 0xffff));
+  return (high << 16) | low;
+}
+
+void PowerStopForTicks(uint32_t ticks) {
+  if (g_rtc_tick_rate == 0) {
+    return;
+  }
+  // The alarm fires when the counter reaches it, so make sure that's at
+  // least a whole tick away, well after we've started waiting for it.
+  if (ticks < 2) {
+    ticks = 2;
+  }
+  const uint32_t alarm = PowerRtcGetCounter() + ticks;
+  RtcWaitForWrite();
+  RTC->CRL |= RTC_CRL_CNF;
+  RTC->ALRH = alarm >> 16;
+  RTC->ALRL = alarm & 0xffff;
+  RTC->CRL &= ~RTC_CRL_CNF;
+  RtcWaitForWrite();
+  RTC->CRL &= ~RTC_CRL_ALRF;
+
+  // The alarm reaches the EXTI controller on its own line, which we use as
+  // an event so that no interrupt handler is needed.
+  const uint32_t line = (1 << EXTI_LINE_RTC_ALARM);
+  EXTI->PR = line;
+  EXTI->RTSR |= line;
+  EXTI->EMR |= line;
+  PowerStop(1);
+  EXTI->EMR &= ~line;
+  EXTI->PR = line;
+  RTC->CRL &= ~RTC_CRL_ALRF;
+}
+
+void PowerWakeOnPin(GPIO_t* gpio, int pin, int edges) {
+  uint32_t port;
+  if (gpio == GPIOA) {
+    port = AFIO_EXTICR_PORT_A;
+  } else if (gpio == GPIOB) {
+    port = AFIO_EXTICR_PORT_B;
+  } else {
+    port = AFIO_EXTICR_PORT_C;
+  }
+  RCC->APB2ENR |= RCC_APB2ENR_AFIOEN;
+  // Each EXTICR register holds the port selections for four lines.
+  const int shift = (pin % 4) * 4;
+  AFIO->EXTICR[pin / 4] =
+      (AFIO->EXTICR[pin / 4] & ~(0xf << shift)) | (port << shift);
+
+  const uint32_t line = (1 << pin);
+  if (edges & POWER_EDGE_RISING) {
+    EXTI->RTSR |= line;
+  } else {
+    EXTI->RTSR &= ~line;
+  }
+  if (edges & POWER_EDGE_FALLING) {
+    EXTI->FTSR |= line;
+  } else {
+    EXTI->FTSR &= ~line;
+  }
+  EXTI->PR = line;
+  EXTI->EMR |= line;
+}
+
+void PowerWakeOnPinOff(int pin) {
+  const uint32_t line = (1 << pin);
+  EXTI->EMR &= ~line;
+  EXTI->PR = line;
+}
+
+void PowerGetResidency(PowerResidency* residency) {
+  AccountAwakeTime();
+  *residency = g_residency;
+}
+
+void PowerResetResidency(void) {
+  g_residency.awake_cycles = 0;
+  g_residency.sleep_cycles = 0;
+  g_residency.stop_cycles = 0;
+  g_residency.sleep_count = 0;
+  g_residency.stop_count = 0;
+  g_last_cycles = DWT->CYCCNT;
+}
@@ -0,0 +1,161 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "scheduler.h"
+
+#include "power.h"
+#include "timebase.h"
+
+static inline void PlaceTask(Scheduler* scheduler, SchedulerTask* task,
+                             int index) {
+  scheduler->heap[index] = task;
+  task->heap_index = index;
+}
+
+// Moves the task at index towards the root until its parent is due first.
+static void SiftUp(Scheduler* scheduler, int index) {
+  SchedulerTask* task = scheduler->heap[index];
+  while (index > 0) {
+    const int parent = (index - 1) / 2;
+    SchedulerTask* parent_task = scheduler->heap[parent];
+    if (parent_task->deadline <= task->deadline) {
+      break;
+    }
+    PlaceTask(scheduler, parent_task, index);
+    index = parent;
+  }
+  PlaceTask(scheduler, task, index);
+}
+
+// Moves the task at index away from the root until both its children are
+// due after it.
+static void SiftDown(Scheduler* scheduler, int index) {
+  SchedulerTask* task = scheduler->heap[index];
+  const int count = scheduler->count;
+  while (1) {
+    int child = (index * 2) + 1;
+    if (child >= count) {
+      break;
+    }
+    if (((child + 1) < count) && (scheduler->heap[child + 1]->deadline <
+                                  scheduler->heap[child]->deadline)) {
+      ++child;
+    }
+    SchedulerTask* child_task = scheduler->heap[child];
+    if (task->deadline <= child_task->deadline) {
+      break;
+    }
+    PlaceTask(scheduler, child_task, index);
+    index = child;
+  }
+  PlaceTask(scheduler, task, index);
+}
+
+static void RemoveAt(Scheduler* scheduler, int index) {
+  scheduler->heap[index]->heap_index = -1;
+  --scheduler->count;
+  if (index == scheduler->count) {
+    return;
+  }
+  // Fill the gap with the last task, which may need to go either way.
+  PlaceTask(scheduler, scheduler->heap[scheduler->count], index);
+  SiftDown(scheduler, index);
+  SiftUp(scheduler, scheduler->heap[index]->heap_index);
+}
+
+void SchedulerInit(Scheduler* scheduler, SchedulerTask** heap, int capacity) {
+  scheduler->heap = heap;
+  scheduler->capacity = capacity;
+  scheduler->count = 0;
+  scheduler->sleep_count = 0;
+}
+
+int SchedulerAdd(Scheduler* scheduler, SchedulerTask* task,
+                 TaskFunction function, void* arg, uint32_t delay,
+                 uint32_t period) {
+  task->function = function;
+  task->arg = arg;
+  task->deadline = TimebaseGet64() + delay;
+  task->period = period;
+  // Moving a task keeps its statistics, so they cover its whole run.
+  if (SchedulerIsScheduled(scheduler, task)) {
+    RemoveAt(scheduler, task->heap_index);
+  } else {
+    task->run_count = 0;
+    task->skipped_count = 0;
+    task->max_lateness = 0;
+  }
+  if (scheduler->count >= scheduler->capacity) {
+    task->heap_index = -1;
+    return 0;
+  }
+  const int index = scheduler->count;
+  ++scheduler->count;
+  PlaceTask(scheduler, task, index);
+  SiftUp(scheduler, index);
+  return 1;
+}
+
+void SchedulerCancel(Scheduler* scheduler, SchedulerTask* task) {
+  if (SchedulerIsScheduled(scheduler, task)) {
+    RemoveAt(scheduler, task->heap_index);
+  }
+}
+
+int SchedulerRunPending(Scheduler* scheduler) {
+  int run_count = 0;
+  while (scheduler->count > 0) {
+    SchedulerTask* task = scheduler->heap[0];
+    const uint64_t now = TimebaseGet64();
+    if (task->deadline > now) {
+      break;
+    }
+    const uint64_t lateness = now - task->deadline;
+    if (lateness > task->max_lateness) {
+      task->max_lateness =
+          (lateness > 0xffffffff) ? 0xffffffff : (uint32_t)(lateness);
+    }
+    if (task->period == 0) {
+      RemoveAt(scheduler, 0);
+    } else {
+      // Stay on the original grid, skipping any runs we've missed entirely.
+      const uint64_t missed = lateness / task->period;
+      task->skipped_count += missed;
+      task->deadline += (missed + 1) * task->period;
+      SiftDown(scheduler, 0);
+    }
+    ++task->run_count;
+    // The task is free to reschedule or cancel itself, since it's already
+    // been dealt with.
+    task->function(task->arg);
+    ++run_count;
+  }
+  return run_count;
+}
+
+void SchedulerRunOnce(Scheduler* scheduler) {
+  SchedulerRunPending(scheduler);
+  if (scheduler->count == 0) {
+    TimebaseCancelAlarm();
+  } else {
+    TimebaseSetAlarm(scheduler->heap[0]->deadline);
+  }
+  // With interrupts masked, one that arrives after the check still ends the
+  // sleep, and its handler runs as soon as they're unmasked.
+  __disable_irq();
+  if ((scheduler->count == 0) ||
+      (scheduler->heap[0]->deadline > TimebaseGet64())) {
+    ++scheduler->sleep_count;
+    PowerSleep();
+  }
+  __enable_irq();
+}
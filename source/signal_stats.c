@@ -0,0 +1,202 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "signal_stats.h"
+
+// The mid-point of the 12-bit unsigned values the ADC produces, used as the
+// reference level until the first block's mean is known.
+#define ADC_OFFSET (2048)
+
+void SignalStatsInit(SignalStatsTracker* tracker, int block_size,
+                     int average_shift) {
+  tracker->block_size = block_size;
+  tracker->block_shift = -1;
+  for (int shift = 0; shift < 31; ++shift) {
+    if ((1 << shift) == block_size) {
+      tracker->block_shift = shift;
+    }
+  }
+  if (tracker->block_shift < 0) {
+    tracker->block_reciprocal =
+        (uint32_t)(((1ULL << 32) + block_size - 1) / block_size);
+  } else {
+    tracker->block_reciprocal = 0;
+  }
+  tracker->center = ADC_OFFSET;
+  tracker->average_shift = average_shift;
+  tracker->block_count = 0;
+}
+
+// Divides by the block size, without using a divide instruction.
+static inline uint64_t DivideByBlockSize64(const SignalStatsTracker* tracker,
+                                           uint64_t value) {
+  if (tracker->block_shift >= 0) {
+    return value >> tracker->block_shift;
+  }
+  // This is (value * reciprocal) >> 32, split into two halves so that the
+  // intermediate results fit into 64 bits.
+  const uint32_t reciprocal = tracker->block_reciprocal;
+  const uint32_t high = (uint32_t)(value >> 32);
+  const uint32_t low = (uint32_t)(value);
+  return ((uint64_t)(high)*reciprocal) +
+         (((uint64_t)(low)*reciprocal) >> 32);
+}
+
+// The same, for results that are known to fit in 32 bits.
+static inline uint32_t DivideByBlockSize(const SignalStatsTracker* tracker,
+                                         uint64_t value) {
+  return (uint32_t)(DivideByBlockSize64(tracker, value));
+}
+
+// Integer square root, rounded down, using the bit-by-bit method.
+static uint32_t SquareRoot(uint32_t value) {
+  uint32_t result = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > value) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (value >= (result + bit)) {
+      value -= (result + bit);
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return result;
+}
+
+// Running totals for a block. Kept in a struct so the per-sample update can
+// be written once, and the compiler keeps all the members in registers once
+// it's inlined.
+typedef struct {
+  uint32_t total;
+  uint64_t total_squared;
+  uint32_t total_abs_deviation;
+  uint32_t crossings;
+  int32_t previous_delta;
+  int32_t min;
+  int32_t max;
+} BlockTotals;
+
+static inline void AccumulateSample(BlockTotals* totals, int32_t center,
+                                    uint32_t value) {
+  totals->total += value;
+  totals->total_squared += value * value;
+  const int32_t delta = (int32_t)(value)-center;
+  const int32_t sign_mask = delta >> 31;
+  totals->total_abs_deviation += (delta ^ sign_mask) - sign_mask;
+  // The top bit of the XOR is only set if the two deltas have different
+  // signs, which means we crossed the reference level.
+  totals->crossings += ((uint32_t)(delta ^ totals->previous_delta)) >> 31;
+  totals->previous_delta = delta;
+  if ((int32_t)(value) < totals->min) {
+    totals->min = value;
+  }
+  if ((int32_t)(value) > totals->max) {
+    totals->max = value;
+  }
+}
+
+static inline void UpdateAverage(int32_t value, int shift, int is_first,
+                                 int32_t* average_q8, int32_t* average) {
+  const int32_t value_q8 = value << 8;
+  if (is_first) {
+    *average_q8 = value_q8;
+  } else {
+    *average_q8 += (value_q8 - *average_q8) >> shift;
+  }
+  *average = (*average_q8 + (1 << 7)) >> 8;
+}
+
+void SignalStatsProcessAdc(SignalStatsTracker* tracker,
+                           const uint16_t* samples, SignalStats* stats) {
+  const int32_t center = tracker->center;
+  const uint16_t* current = samples;
+  const uint16_t* const end = samples + tracker->block_size;
+
+  BlockTotals totals;
+  totals.total = 0;
+  totals.total_squared = 0;
+  totals.total_abs_deviation = 0;
+  totals.crossings = 0;
+  totals.previous_delta = (int32_t)(samples[0]) - center;
+  totals.min = INT32_MAX;
+  totals.max = INT32_MIN;
+
+  // Step forward a single sample if needed, so we can use 32-bit loads.
+  if ((((uintptr_t)(current)) & 3) != 0) {
+    AccumulateSample(&totals, center, *current);
+    ++current;
+  }
+  // Read pairs of samples. The Cortex M3 is little-endian, so the first of
+  // each pair is in the bottom half of the word.
+  const uint32_t* pairs = (const uint32_t*)(current);
+  const int pair_count = (end - current) / 2;
+  for (int i = 0; i < pair_count; ++i) {
+    const uint32_t pair = pairs[i];
+    AccumulateSample(&totals, center, pair & 0xffff);
+    AccumulateSample(&totals, center, pair >> 16);
+  }
+  current += (pair_count * 2);
+  if (current != end) {
+    AccumulateSample(&totals, center, *current);
+  }
+
+  stats->mean = DivideByBlockSize(tracker, totals.total);
+  // The variance is (sum(x^2) - (sum(x)^2 / n)) / n, which avoids losing
+  // precision by rounding the mean before squaring it. The samples aren't
+  // centered, so sum(x)^2 / n is around n * mean^2, which overflows 32 bits
+  // for a mid-scale signal, and has to stay in 64 bits until the final
+  // division. The reciprocal rounds up, so for a nearly constant signal it
+  // can come out slightly larger than sum(x^2).
+  const uint64_t squared_total_over_n =
+      DivideByBlockSize64(tracker, (uint64_t)(totals.total) * totals.total);
+  uint32_t variance = 0;
+  if (totals.total_squared > squared_total_over_n) {
+    variance = DivideByBlockSize(tracker,
+                                 totals.total_squared - squared_total_over_n);
+  }
+  stats->rms = SquareRoot(variance);
+  stats->mean_abs_deviation =
+      DivideByBlockSize(tracker, totals.total_abs_deviation);
+  stats->min = totals.min;
+  stats->max = totals.max;
+  stats->peak_to_peak = totals.max - totals.min;
+  stats->zero_crossings = totals.crossings;
+  stats->zero_crossing_rate =
+      DivideByBlockSize(tracker, (uint64_t)(totals.crossings) << 15);
+
+  tracker->center = stats->mean;
+
+  const int shift = tracker->average_shift;
+  const int is_first = (tracker->block_count == 0);
+  SignalStats* average = &tracker->average;
+  SignalStats* average_q8 = &tracker->average_q8;
+  UpdateAverage(stats->mean, shift, is_first, &average_q8->mean,
+                &average->mean);
+  UpdateAverage(stats->rms, shift, is_first, &average_q8->rms, &average->rms);
+  UpdateAverage(stats->mean_abs_deviation, shift, is_first,
+                &average_q8->mean_abs_deviation, &average->mean_abs_deviation);
+  UpdateAverage(stats->min, shift, is_first, &average_q8->min, &average->min);
+  UpdateAverage(stats->max, shift, is_first, &average_q8->max, &average->max);
+  UpdateAverage(stats->peak_to_peak, shift, is_first,
+                &average_q8->peak_to_peak, &average->peak_to_peak);
+  UpdateAverage(stats->zero_crossings, shift, is_first,
+                &average_q8->zero_crossings, &average->zero_crossings);
+  UpdateAverage(stats->zero_crossing_rate, shift, is_first,
+                &average_q8->zero_crossing_rate, &average->zero_crossing_rate);
+  if (tracker->block_count < INT32_MAX) {
+    ++tracker->block_count;
+  }
+}
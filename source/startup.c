@@ -39,7 +39,22 @@ __attribute__((section(".text.interrupt_handler"))) void _infinite_loop() {
 // Overridable interrupt handlers
 __attribute__((weak)) void MemFaultHandler() { _infinite_loop(); }
 __attribute__((weak)) void BusFaultHandler() { _infinite_loop(); }
-__attribute__((weak)) void OnAdcInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void UsageFaultHandler() { _infinite_loop(); }
+__attribute__((weak)) void OnNmi() { _infinite_loop(); }
+__attribute__((weak)) void OnSVCall() { _infinite_loop(); }
+__attribute__((weak)) void OnDebugMonitor() { _infinite_loop(); }
+__attribute__((weak)) void OnPendSV() { _infinite_loop(); }
+__attribute__((weak)) void OnWwdgInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnPvdInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTamperInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnRtcInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnFlashInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnRccInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnExti0Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnExti1Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnExti2Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnExti3Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnExti4Interrupt() { _infinite_loop(); }
 __attribute__((weak)) void OnDma1Channel1Interrupt() { _infinite_loop(); }
 __attribute__((weak)) void OnDma1Channel2Interrupt() { _infinite_loop(); }
 __attribute__((weak)) void OnDma1Channel3Interrupt() { _infinite_loop(); }
@@ -47,6 +62,48 @@ __attribute__((weak)) void OnDma1Channel4Interrupt() { _infinite_loop(); }
 __attribute__((weak)) void OnDma1Channel5Interrupt() { _infinite_loop(); }
 __attribute__((weak)) void OnDma1Channel6Interrupt() { _infinite_loop(); }
 __attribute__((weak)) void OnDma1Channel7Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnAdcInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnUsbHpCan1TxInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnUsbLpCan1Rx0Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnCan1Rx1Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnCan1SceInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnExti9To5Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim1BreakInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim1UpdateInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim1TriggerInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim1CaptureCompareInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim2Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim3Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim4Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnI2c1EventInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnI2c1ErrorInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnI2c2EventInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnI2c2ErrorInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnSpi1Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnSpi2Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnUsart1Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnUsart2Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnUsart3Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnExti15To10Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnRtcAlarmInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnUsbWakeUpInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim8BreakInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim8UpdateInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim8TriggerInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim8CaptureCompareInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnAdc3Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnFsmcInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnSdioInterrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim5Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnSpi3Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnUart4Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnUart5Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim6Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnTim7Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnDma2Channel1Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnDma2Channel2Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnDma2Channel3Interrupt() { _infinite_loop(); }
+__attribute__((weak)) void OnDma2Channel4And5Interrupt() { _infinite_loop(); }
 
 // We need this assembler to store the register information for debugging.
 void HardFaultHandlerASM(void) {
@@ -137,31 +194,31 @@ static volatile interrupt_fn interrupts[] = {
     (interrupt_fn)&_ld_stack_end_addr,  // Stack start end size (from linker
                                         // script)
     _main,                              // Reset.
-    _infinite_loop,                     // NMI.
+    OnNmi,                              // NMI.
     HardFaultHandlerASM,                // Hard Fault.
     MemFaultHandler,                    // MM Fault.
     BusFaultHandler,                    // Bus Fault.
-    _infinite_loop,                     // Usage Fault.
-    _infinite_loop,                     // Unused.
+    UsageFaultHandler,                  // Usage Fault.
     _infinite_loop,                     // Unused.
     _infinite_loop,                     // Unused.
     _infinite_loop,                     // Unused.
-    _infinite_loop,                     // SV call.
     _infinite_loop,                     // Unused.
+    OnSVCall,                           // SV call.
+    OnDebugMonitor,                     // Debug monitor.
     _infinite_loop,                     // Unused.
-    _infinite_loop,                     // PendSV.
+    OnPendSV,                           // PendSV.
     OnSysTick,                          // SysTick.
-    _infinite_loop,                     // IRQ0.
-    _infinite_loop,                     // IRQ1.
-    _infinite_loop,                     // IRQ2.
-    _infinite_loop,                     // IRQ3.
-    _infinite_loop,                     // IRQ4.
-    _infinite_loop,                     // IRQ5.
-    _infinite_loop,                     // IRQ6.
-    _infinite_loop,                     // IRQ7.
-    _infinite_loop,                     // IRQ8.
-    _infinite_loop,                     // IRQ9.
-    _infinite_loop,                     // IRQ10.
+    OnWwdgInterrupt,                    // IRQ0.
+    OnPvdInterrupt,                     // IRQ1.
+    OnTamperInterrupt,                  // IRQ2.
+    OnRtcInterrupt,                     // IRQ3.
+    OnFlashInterrupt,                   // IRQ4.
+    OnRccInterrupt,                     // IRQ5.
+    OnExti0Interrupt,                   // IRQ6.
+    OnExti1Interrupt,                   // IRQ7.
+    OnExti2Interrupt,                   // IRQ8.
+    OnExti3Interrupt,                   // IRQ9.
+    OnExti4Interrupt,                   // IRQ10.
     OnDma1Channel1Interrupt,            // IRQ11.
     OnDma1Channel2Interrupt,            // IRQ12.
     OnDma1Channel3Interrupt,            // IRQ13.
@@ -170,38 +227,45 @@ static volatile interrupt_fn interrupts[] = {
     OnDma1Channel6Interrupt,            // IRQ16.
     OnDma1Channel7Interrupt,            // IRQ17.
     OnAdcInterrupt,                     // IRQ18.
-    _infinite_loop,                     // IRQ19.
-    _infinite_loop,                     // IRQ20.
-    _infinite_loop,                     // IRQ21.
-    _infinite_loop,                     // IRQ22.
-    _infinite_loop,                     // IRQ23.
-    _infinite_loop,                     // IRQ24.
-    _infinite_loop,                     // IRQ25.
-    _infinite_loop,                     // IRQ26.
-    _infinite_loop,                     // IRQ27.
-    _infinite_loop,                     // IRQ28.
-    _infinite_loop,                     // IRQ29.
-    _infinite_loop,                     // IRQ30.
-    _infinite_loop,                     // IRQ31.
-    _infinite_loop,                     // IRQ32.
-    _infinite_loop,                     // IRQ33.
-    _infinite_loop,                     // IRQ34.
-    _infinite_loop,                     // IRQ35.
-    _infinite_loop,                     // IRQ36.
-    _infinite_loop,                     // IRQ37.
-    _infinite_loop,                     // IRQ38.
-    _infinite_loop,                     // IRQ39.
-    _infinite_loop,                     // IRQ40.
-    _infinite_loop,                     // IRQ41.
-    _infinite_loop,                     // IRQ42.
-    _infinite_loop,                     // IRQ43.
-    _infinite_loop,                     // IRQ44.
-    _infinite_loop,                     // IRQ45.
-    _infinite_loop,                     // IRQ46.
-    _infinite_loop,                     // IRQ47.
-    _infinite_loop,                     // IRQ48.
-    _infinite_loop,                     // IRQ49.
-    _infinite_loop,                     // IRQ50.
-    _infinite_loop,                     // IRQ51.
-    _infinite_loop                      // IRQ52.
+    OnUsbHpCan1TxInterrupt,             // IRQ19.
+    OnUsbLpCan1Rx0Interrupt,            // IRQ20.
+    OnCan1Rx1Interrupt,                 // IRQ21.
+    OnCan1SceInterrupt,                 // IRQ22.
+    OnExti9To5Interrupt,                // IRQ23.
+    OnTim1BreakInterrupt,               // IRQ24.
+    OnTim1UpdateInterrupt,              // IRQ25.
+    OnTim1TriggerInterrupt,             // IRQ26.
+    OnTim1CaptureCompareInterrupt,      // IRQ27.
+    OnTim2Interrupt,                    // IRQ28.
+    OnTim3Interrupt,                    // IRQ29.
+    OnTim4Interrupt,                    // IRQ30.
+    OnI2c1EventInterrupt,               // IRQ31.
+    OnI2c1ErrorInterrupt,               // IRQ32.
+    OnI2c2EventInterrupt,               // IRQ33.
+    OnI2c2ErrorInterrupt,               // IRQ34.
+    OnSpi1Interrupt,                    // IRQ35.
+    OnSpi2Interrupt,                    // IRQ36.
+    OnUsart1Interrupt,                  // IRQ37.
+    OnUsart2Interrupt,                  // IRQ38.
+    OnUsart3Interrupt,                  // IRQ39.
+    OnExti15To10Interrupt,              // IRQ40.
+    OnRtcAlarmInterrupt,                // IRQ41.
+    OnUsbWakeUpInterrupt,               // IRQ42.
+    OnTim8BreakInterrupt,               // IRQ43.
+    OnTim8UpdateInterrupt,              // IRQ44.
+    OnTim8TriggerInterrupt,             // IRQ45.
+    OnTim8CaptureCompareInterrupt,      // IRQ46.
+    OnAdc3Interrupt,                    // IRQ47.
+    OnFsmcInterrupt,                    // IRQ48.
+    OnSdioInterrupt,                    // IRQ49.
+    OnTim5Interrupt,                    // IRQ50.
+    OnSpi3Interrupt,                    // IRQ51.
+    OnUart4Interrupt,                   // IRQ52.
+    OnUart5Interrupt,                   // IRQ53.
+    OnTim6Interrupt,                    // IRQ54.
+    OnTim7Interrupt,                    // IRQ55.
+    OnDma2Channel1Interrupt,            // IRQ56.
+    OnDma2Channel2Interrupt,            // IRQ57.
+    OnDma2Channel3Interrupt,            // IRQ58.
+    OnDma2Channel4And5Interrupt         // IRQ59.
 };
@@ -0,0 +1,171 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "timebase.h"
+
+#include "vector_table.h"
+
+volatile uint32_t g_timebase_overflow_count = 0;
+
+static volatile int g_is_alarm_set = 0;
+static volatile uint64_t g_alarm_deadline;
+
+static void OnTim2Interrupt(void);
+static void OnTim4Interrupt(void);
+
+void TimebaseInit(void) {
+  TimerEnableClock(TIMERID_TIM2);
+  TimerEnableClock(TIMERID_TIM4);
+  TIM2->CR1 = 0;
+  TIM4->CR1 = 0;
+  NVIC_DisableIRQ(TIM4_IRQn);
+
+  // The master counts microseconds. Force an update to load the prescaler
+  // before connecting its trigger output, so the slave doesn't see it.
+  TIM2->PSC = (TimerGetClockRate(TIMERID_TIM2) / 1000000) - 1;
+  TIM2->ARR = 0xffff;
+  TIM2->CR2 = TIM_CR2_MMS_RESET;
+  // Channel 1 is only used as a compare for alarms, with no output.
+  TIM2->CCMR1 = 0;
+  TIM2->CCER = 0;
+  TIM2->EGR = TIM_EGR_UG;
+  TIM2->CR2 = TIM_CR2_MMS_UPDATE;
+
+  // The slave counts the master's update events, which arrive on ITR1.
+  TIM4->PSC = 0;
+  TIM4->ARR = 0xffff;
+  TIM4->EGR = TIM_EGR_UG;
+  TIM4->SMCR = TIM_SMCR_TS_ITR1 | TIM_SMCR_SMS_EXTERNAL_CLOCK;
+  TIM4->CCMR1 = 0;
+  TIM4->CCER = 0;
+
+  TIM2->CNT = 0;
+  TIM4->CNT = 0;
+  TIM2->SR = 0;
+  TIM4->SR = 0;
+  g_timebase_overflow_count = 0;
+  g_is_alarm_set = 0;
+  TIM2->DIER = 0;
+  TIM4->DIER = TIM_DIER_UIE;
+  // The handlers are installed here rather than at link time, so programs
+  // that don't use the timebase can still have their own.
+  VectorTableSetHandler(TIM2_IRQn, OnTim2Interrupt);
+  VectorTableSetHandler(TIM4_IRQn, OnTim4Interrupt);
+  NVIC_EnableIRQ(TIM2_IRQn);
+  NVIC_EnableIRQ(TIM4_IRQn);
+
+  TIM4->CR1 = TIM_CR1_CEN;
+  TIM2->CR1 = TIM_CR1_CEN;
+}
+
+uint64_t TimebaseGet64(void) {
+  uint32_t high;
+  uint32_t low;
+  int is_overflow_pending;
+  do {
+    high = g_timebase_overflow_count;
+    low = TimebaseGet32();
+    is_overflow_pending = ((TIM4->SR & TIM_SR_UIF) != 0);
+  } while (high != g_timebase_overflow_count);
+  // If the count has wrapped but the interrupt hasn't been handled yet,
+  // because interrupts are disabled or we're in a higher-priority handler,
+  // count the overflow ourselves. A large count means we read it before it
+  // wrapped, so the flag must have been set afterwards.
+  if (is_overflow_pending && (low < 0x80000000)) {
+    ++high;
+  }
+  return ((uint64_t)(high) << 32) | low;
+}
+
+// Sets up the compare that gets closest to the alarm deadline without
+// passing it. This must be called with interrupts disabled, or from one of
+// the timer handlers, which TimebaseSetInterruptPriority() keeps at the same
+// priority.
+static void ArmAlarm(void) {
+  TIM2->DIER &= ~TIM_DIER_CC1IE;
+  TIM4->DIER &= ~TIM_DIER_CC1IE;
+  while (g_is_alarm_set) {
+    const uint64_t deadline = g_alarm_deadline;
+    const uint64_t now = TimebaseGet64();
+    if (now >= deadline) {
+      // Pend the interrupt ourselves, since the compare has been missed.
+      g_is_alarm_set = 0;
+      NVIC_SetPendingIRQ(TIM2_IRQn);
+      return;
+    }
+    // The compare flag is cleared before the interrupt is enabled, so if
+    // the counters have moved on past the compare value by the time that's
+    // done, the match may have been lost, and we go round again.
+    if ((now >> 16) == (deadline >> 16)) {
+      // Due within this lap of TIM2.
+      TIM2->CCR1 = deadline & 0xffff;
+      TIM2->SR = ~TIM_SR_CC1IF;
+      TIM2->DIER |= TIM_DIER_CC1IE;
+      if (TimebaseGet64() < deadline) {
+        return;
+      }
+      TIM2->DIER &= ~TIM_DIER_CC1IE;
+    } else if ((now >> 32) == (deadline >> 32)) {
+      // Due within this lap of TIM4, so wait for the right TIM2 lap.
+      TIM4->CCR1 = (deadline >> 16) & 0xffff;
+      TIM4->SR = ~TIM_SR_CC1IF;
+      TIM4->DIER |= TIM_DIER_CC1IE;
+      if ((TimebaseGet64() >> 16) < (deadline >> 16)) {
+        return;
+      }
+      TIM4->DIER &= ~TIM_DIER_CC1IE;
+    } else {
+      // TIM4's overflow interrupt will call back in here.
+      return;
+    }
+  }
+}
+
+void TimebaseSetAlarm(uint64_t deadline) {
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  g_alarm_deadline = deadline;
+  g_is_alarm_set = 1;
+  ArmAlarm();
+  __set_PRIMASK(primask);
+}
+
+void TimebaseCancelAlarm(void) {
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  g_is_alarm_set = 0;
+  ArmAlarm();
+  __set_PRIMASK(primask);
+}
+
+static void OnTim2Interrupt(void) {
+  if (TIM2->SR & TIM_SR_CC1IF) {
+    TIM2->SR = ~TIM_SR_CC1IF;
+    TIM2->DIER &= ~TIM_DIER_CC1IE;
+    g_is_alarm_set = 0;
+  }
+}
+
+static void OnTim4Interrupt(void) {
+  const uint32_t status = TIM4->SR;
+  if (status & TIM_SR_UIF) {
+    TIM4->SR = ~TIM_SR_UIF;
+    ++g_timebase_overflow_count;
+  }
+  if (status & TIM_SR_CC1IF) {
+    TIM4->SR = ~TIM_SR_CC1IF;
+  }
+  // Move on to the next stage of the alarm, if there's one waiting.
+  if (status & (TIM_SR_UIF | TIM_SR_CC1IF)) {
+    ArmAlarm();
+  }
+}
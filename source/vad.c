@@ -0,0 +1,81 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "vad.h"
+
+// How quickly the noise floor follows the signal down and up, as shifts. The
+// floor halves the distance to a quieter block straight away, but only moves
+// 1/128th of the way towards a louder one, which takes a few seconds with
+// 32ms blocks.
+#define NOISE_FLOOR_FALL_SHIFT (1)
+#define NOISE_FLOOR_RISE_SHIFT (7)
+
+void VadInit(VoiceActivityDetector* vad, int32_t threshold_ratio_q8,
+             int32_t min_rms, int32_t max_zero_crossing_rate,
+             int hangover_blocks) {
+  vad->threshold_ratio_q8 = threshold_ratio_q8;
+  vad->min_rms = min_rms;
+  vad->max_zero_crossing_rate = max_zero_crossing_rate;
+  vad->hangover_blocks = hangover_blocks;
+  // A negative floor means we haven't seen any blocks yet.
+  vad->noise_floor_q8 = -1;
+  vad->hangover_remaining = 0;
+  vad->is_active = 0;
+  VadResetDutyCycle(vad);
+}
+
+int VadUpdate(VoiceActivityDetector* vad, const SignalStats* stats) {
+  const int32_t rms_q8 = stats->rms << 8;
+  if (vad->noise_floor_q8 < 0) {
+    vad->noise_floor_q8 = rms_q8;
+  }
+
+  const int32_t threshold_q8 =
+      (int32_t)(((int64_t)(vad->noise_floor_q8) * vad->threshold_ratio_q8) >>
+                8);
+  const int is_loud = (rms_q8 > threshold_q8) && (stats->rms >= vad->min_rms);
+  const int is_voice_like =
+      (stats->zero_crossing_rate <= vad->max_zero_crossing_rate);
+  if (is_loud && is_voice_like) {
+    vad->hangover_remaining = vad->hangover_blocks;
+    vad->is_active = 1;
+  } else if (vad->hangover_remaining > 0) {
+    --vad->hangover_remaining;
+    vad->is_active = 1;
+  } else {
+    vad->is_active = 0;
+  }
+
+  // The floor keeps rising slowly even while we're active, so that a noise
+  // source that starts and never stops will eventually become background,
+  // rather than keeping the detector on forever.
+  const int32_t delta_q8 = rms_q8 - vad->noise_floor_q8;
+  if (delta_q8 < 0) {
+    vad->noise_floor_q8 += delta_q8 >> NOISE_FLOOR_FALL_SHIFT;
+  } else {
+    vad->noise_floor_q8 += delta_q8 >> NOISE_FLOOR_RISE_SHIFT;
+  }
+
+  ++vad->block_count;
+  if (vad->is_active) {
+    ++vad->active_block_count;
+  }
+  return vad->is_active;
+}
+
+int32_t VadGetDutyCycle(const VoiceActivityDetector* vad) {
+  if (vad->block_count == 0) {
+    return 0;
+  }
+  return (int32_t)(((uint64_t)(vad->active_block_count) << 15) /
+                   vad->block_count);
+}
@@ -0,0 +1,66 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "vector_table.h"
+
+// Where flash starts. At reset, VTOR is zero, which is an alias for this
+// when booting from flash.
+#define FLASH_START_ADDRESS (0x08000000)
+
+// VTOR needs the table aligned to its size, rounded up to a power of two.
+static VectorHandler g_sram_table[VECTOR_TABLE_COUNT]
+    __attribute__((aligned(512)));
+
+// Returns the table the processor is using right now.
+static volatile VectorHandler* CurrentTable(void) {
+  uint32_t address = SCB->VTOR;
+  if (address == 0) {
+    address = FLASH_START_ADDRESS;
+  }
+  return (volatile VectorHandler*)(address);
+}
+
+int VectorTableIsRelocated(void) {
+  return SCB->VTOR == (uint32_t)(g_sram_table);
+}
+
+void VectorTableRelocate(void) {
+  if (VectorTableIsRelocated()) {
+    return;
+  }
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  volatile VectorHandler* current = CurrentTable();
+  for (int i = 0; i < VECTOR_TABLE_COUNT; ++i) {
+    g_sram_table[i] = current[i];
+  }
+  // Make sure the copy is complete before the processor can fetch from it.
+  __DSB();
+  SCB->VTOR = (uint32_t)(g_sram_table);
+  __DSB();
+  __ISB();
+  __set_PRIMASK(primask);
+}
+
+VectorHandler VectorTableSetHandler(IRQn_Type irq, VectorHandler handler) {
+  VectorTableRelocate();
+  volatile VectorHandler* entry =
+      &g_sram_table[VECTOR_TABLE_SYSTEM_COUNT + irq];
+  const VectorHandler previous = *entry;
+  *entry = handler;
+  __DSB();
+  return previous;
+}
+
+VectorHandler VectorTableGetHandler(IRQn_Type irq) {
+  return CurrentTable()[VECTOR_TABLE_SYSTEM_COUNT + irq];
+}
@@ -0,0 +1,96 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "weight_prefetch.h"
+
+#include "dma.h"
+
+int WeightPrefetchRowsPerTile(int row_bytes, int row_count,
+                              int scratch_bytes) {
+  // Each half of the scratch buffer starts on a word boundary.
+  const int half_bytes = (scratch_bytes / 2) & ~3;
+  int rows_per_tile = half_bytes / row_bytes;
+  if (rows_per_tile > row_count) {
+    rows_per_tile = row_count;
+  }
+  // Keep each tile within a single DMA transfer, even when copying bytes.
+  const int max_rows = DMA_MAX_TRANSFER_COUNT / row_bytes;
+  if (rows_per_tile > max_rows) {
+    rows_per_tile = max_rows;
+  }
+  return rows_per_tile;
+}
+
+// Copies with the widest elements the addresses and size allow.
+static void StartTileCopy(int channel, uint8_t* dest, const uint8_t* source,
+                          int byte_count) {
+  const uint32_t alignment =
+      (uint32_t)(dest) | (uint32_t)(source) | (uint32_t)(byte_count);
+  if ((alignment & 3) == 0) {
+    DmaCopyStart(channel, dest, source, byte_count / 4, DMA_WIDTH_32, 0, 0);
+  } else if ((alignment & 1) == 0) {
+    DmaCopyStart(channel, dest, source, byte_count / 2, DMA_WIDTH_16, 0, 0);
+  } else {
+    DmaCopyStart(channel, dest, source, byte_count, DMA_WIDTH_8, 0, 0);
+  }
+}
+
+int WeightPrefetchRun(const uint8_t* weights, int row_bytes, int row_count,
+                      uint8_t* scratch, int scratch_bytes,
+                      WeightTileFunction function, void* arg) {
+  const int rows_per_tile =
+      WeightPrefetchRowsPerTile(row_bytes, row_count, scratch_bytes);
+  if (rows_per_tile < 1) {
+    return 0;
+  }
+  const int tile_count = (row_count + rows_per_tile - 1) / rows_per_tile;
+
+  const int channel = DmaClaimChannel();
+  if (channel == 0) {
+    for (int tile = 0; tile < tile_count; ++tile) {
+      const int first_row = tile * rows_per_tile;
+      int tile_rows = row_count - first_row;
+      if (tile_rows > rows_per_tile) {
+        tile_rows = rows_per_tile;
+      }
+      function(weights + (first_row * row_bytes), first_row, tile_rows, arg);
+    }
+    return tile_count;
+  }
+
+  uint8_t* buffers[2];
+  buffers[0] = scratch;
+  buffers[1] = scratch + ((scratch_bytes / 2) & ~3);
+
+  // The first tile has nothing to hide behind, so wait for it.
+  int tile_rows = (row_count < rows_per_tile) ? row_count : rows_per_tile;
+  StartTileCopy(channel, buffers[0], weights, tile_rows * row_bytes);
+  DmaWait(channel);
+  for (int tile = 0; tile < tile_count; ++tile) {
+    const int first_row = tile * rows_per_tile;
+    const int next_first_row = first_row + tile_rows;
+    int next_tile_rows = row_count - next_first_row;
+    if (next_tile_rows > rows_per_tile) {
+      next_tile_rows = rows_per_tile;
+    }
+    if (next_tile_rows > 0) {
+      StartTileCopy(channel, buffers[(tile + 1) & 1],
+                    weights + (next_first_row * row_bytes),
+                    next_tile_rows * row_bytes);
+    }
+    function(buffers[tile & 1], first_row, tile_rows, arg);
+    DmaWait(channel);
+    tile_rows = next_tile_rows;
+  }
+  DmaReleaseChannel(channel);
+  return tile_count;
+}
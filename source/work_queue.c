@@ -0,0 +1,85 @@
+/* Copyright 2018 Google Inc. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "work_queue.h"
+
+void WorkQueueInit(WorkQueue* queue, WorkItem* items, int capacity,
+                   int use_pend_sv) {
+  queue->items = items;
+  MpscRingInit(&queue->ring, &items[0].sequence, sizeof(WorkItem), capacity);
+  queue->use_pend_sv = use_pend_sv;
+  WorkQueueResetStats(queue);
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  if (use_pend_sv) {
+    NVIC_SetPriority(PendSV_IRQn, (1 << __NVIC_PRIO_BITS) - 1);
+  }
+}
+
+int WorkQueuePost(WorkQueue* queue, WorkFunction function, void* arg) {
+  MpscRing* ring = &queue->ring;
+  uint32_t position;
+  if (!MpscRingClaim(ring, &position)) {
+    AtomicIncrement(&queue->dropped_count);
+    return 0;
+  }
+  WorkItem* item = &queue->items[MpscRingSlot(ring, position)];
+  item->function = function;
+  item->arg = arg;
+  item->post_cycles = DWT->CYCCNT;
+  MpscRingPublish(ring, position);
+
+  AtomicIncrement(&queue->posted_count);
+  AtomicMax(&queue->high_water, (position + 1) - ring->tail);
+  if (queue->use_pend_sv) {
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+  }
+  return 1;
+}
+
+int WorkQueueRunPending(WorkQueue* queue) {
+  MpscRing* ring = &queue->ring;
+  int run_count = 0;
+  uint32_t position;
+  // Stop at the first item that isn't ready. It may have been claimed by a
+  // handler that was then preempted before publishing it, in which case it'll
+  // be run the next time round.
+  while (MpscRingPeek(ring, &position)) {
+    const WorkItem* item = &queue->items[MpscRingSlot(ring, position)];
+    const WorkFunction function = item->function;
+    void* const arg = item->arg;
+    const uint32_t latency = DWT->CYCCNT - item->post_cycles;
+    // Free the slot before running the item, so handlers can post more work
+    // while it's busy.
+    MpscRingRelease(ring);
+
+    if (latency > queue->max_latency_cycles) {
+      queue->max_latency_cycles = latency;
+    }
+    queue->total_latency_cycles += latency;
+    ++queue->run_count;
+    function(arg);
+    ++run_count;
+  }
+  return run_count;
+}
+
+void WorkQueueResetStats(WorkQueue* queue) {
+  queue->posted_count = 0;
+  queue->dropped_count = 0;
+  queue->high_water = 0;
+  queue->run_count = 0;
+  queue->max_latency_cycles = 0;
+  queue->total_latency_cycles = 0;
+}